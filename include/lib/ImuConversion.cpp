@@ -0,0 +1,119 @@
+#include "ImuConversion.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/******************************************************************************
+ImuConversion: Create object with identity remap, unit scale and no bias
+******************************************************************************/
+ImuConversion::ImuConversion(){
+    for (int i = 0; i < IMU_LANES; i++) {
+        _source[i] = i < IMU_CHANNELS ? i : 0;
+        _gain[i] = 0.0;
+        _offset[i] = 0.0;
+    }
+    for (int i = 0; i < IMU_CHANNELS; i++) {
+        _sign[i] = 1.0;
+        _scale[i] = 1.0;
+        _unit[i] = 1.0;
+        _bias[i] = 0.0;
+    }
+    update();
+}
+
+/******************************************************************************
+setScale: sensor scale per LSB of each raw channel
+******************************************************************************/
+void ImuConversion::setScale(const float scale[IMU_CHANNELS]){
+    for (int i = 0; i < IMU_CHANNELS; i++)
+        _scale[i] = scale[i];
+    update();
+}
+
+/******************************************************************************
+setRemap: output channel i is sign[i] * raw channel source[i]
+******************************************************************************/
+void ImuConversion::setRemap(const int source[IMU_CHANNELS], const float sign[IMU_CHANNELS]){
+    for (int i = 0; i < IMU_CHANNELS; i++) {
+        _source[i] = source[i];
+        _sign[i] = sign[i];
+    }
+    update();
+}
+
+/******************************************************************************
+setUnit: factor applied after scaling, per output channel
+******************************************************************************/
+void ImuConversion::setUnit(const float unit[IMU_CHANNELS]){
+    for (int i = 0; i < IMU_CHANNELS; i++)
+        _unit[i] = unit[i];
+    update();
+}
+
+/******************************************************************************
+setBias: value subtracted from each output channel
+******************************************************************************/
+void ImuConversion::setBias(const float bias[IMU_CHANNELS]){
+    for (int i = 0; i < IMU_CHANNELS; i++)
+        _bias[i] = bias[i];
+    update();
+}
+
+/******************************************************************************
+convert: convert n raw samples, out receives IMU_CHANNELS floats per sample
+******************************************************************************/
+void ImuConversion::convert(const InertialRawSample *raw, float *out, int n) const {
+    int16_t lanes[IMU_LANES] = {0};
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t g0 = vld1q_f32(&_gain[0]), g1 = vld1q_f32(&_gain[4]), g2 = vld1q_f32(&_gain[8]);
+    float32x4_t o0 = vld1q_f32(&_offset[0]), o1 = vld1q_f32(&_offset[4]), o2 = vld1q_f32(&_offset[8]);
+#elif defined(__SSE2__)
+    __m128 g0 = _mm_loadu_ps(&_gain[0]), g1 = _mm_loadu_ps(&_gain[4]), g2 = _mm_loadu_ps(&_gain[8]);
+    __m128 o0 = _mm_loadu_ps(&_offset[0]), o1 = _mm_loadu_ps(&_offset[4]), o2 = _mm_loadu_ps(&_offset[8]);
+#endif
+
+    for (int s = 0; s < n; s++, out += IMU_CHANNELS) {
+        // gather the raw channels in output order
+        const int16_t *data = raw[s].data;
+        for (int i = 0; i < IMU_CHANNELS; i++)
+            lanes[i] = data[_source[i]];
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        int16x8_t l01 = vld1q_s16(&lanes[0]);
+        int16x4_t l2 = vld1_s16(&lanes[8]);
+        float32x4_t f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(l01)));
+        float32x4_t f1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(l01)));
+        float32x4_t f2 = vcvtq_f32_s32(vmovl_s16(l2));
+        vst1q_f32(&out[0], vsubq_f32(vmulq_f32(f0, g0), o0));
+        vst1q_f32(&out[4], vsubq_f32(vmulq_f32(f1, g1), o1));
+        out[8] = vgetq_lane_f32(vsubq_f32(vmulq_f32(f2, g2), o2), 0);
+#elif defined(__SSE2__)
+        __m128i l01 = _mm_loadu_si128((const __m128i *)&lanes[0]);
+        __m128i l2 = _mm_loadl_epi64((const __m128i *)&lanes[8]);
+        // sign extend int16 to int32 by unpacking against itself and shifting
+        __m128 f0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(l01, l01), 16));
+        __m128 f1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(l01, l01), 16));
+        __m128 f2 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(l2, l2), 16));
+        _mm_storeu_ps(&out[0], _mm_sub_ps(_mm_mul_ps(f0, g0), o0));
+        _mm_storeu_ps(&out[4], _mm_sub_ps(_mm_mul_ps(f1, g1), o1));
+        out[8] = _mm_cvtss_f32(_mm_sub_ps(_mm_mul_ps(f2, g2), o2));
+#else
+        for (int i = 0; i < IMU_CHANNELS; i++)
+            out[i] = lanes[i] * _gain[i] - _offset[i];
+#endif
+    }
+}
+
+/******************************************************************************
+update: fold sign, scale, unit and bias into gain and offset per lane
+******************************************************************************/
+void ImuConversion::update(){
+    for (int i = 0; i < IMU_CHANNELS; i++) {
+        _gain[i] = _sign[i] * _scale[_source[i]] * _unit[i];
+        _offset[i] = _bias[i];
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef IMUCONVERSION_H
+#define IMUCONVERSION_H
+
+#include "Navio/Common/InertialSensor.h"
+
+#define IMU_CHANNELS 9      // ax ay az gx gy gz mx my mz
+#define IMU_LANES    12     // channels padded to three 4-wide vectors
+
+/******************************************************************************
+ImuConversion: convert raw int16 IMU samples to floats in one pass.
+Axis remap, sensor scale, unit conversion and bias are folded into a gain and
+an offset per output channel, so each sample costs one gather, three vector
+multiplies and three vector subtractions (NEON on the Pi, SSE2 on x86).
+******************************************************************************/
+class ImuConversion {
+public:
+    ImuConversion();
+    void setScale(const float scale[IMU_CHANNELS]);
+    void setRemap(const int source[IMU_CHANNELS], const float sign[IMU_CHANNELS]);
+    void setUnit(const float unit[IMU_CHANNELS]);
+    void setBias(const float bias[IMU_CHANNELS]);
+    void convert(const InertialRawSample *raw, float *out, int n) const;
+
+private:
+    int _source[IMU_LANES];
+    float _sign[IMU_CHANNELS], _scale[IMU_CHANNELS], _unit[IMU_CHANNELS], _bias[IMU_CHANNELS];
+    float _gain[IMU_LANES], _offset[IMU_LANES];
+    void update();
+};
+
+#endif /* IMUCONVERSION_H */
@@ -0,0 +1,179 @@
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "GpsService.h"
+
+GpsService::GpsService(std::string device) :
+    ublox(device),
+    head(0),
+    errors(0),
+    period_ms(1000 / GPS_DEFAULT_RATE_HZ),
+    running(false)
+{
+    memset(ring, 0, sizeof(ring));
+    dispatcher.add(on_pvt, this);
+}
+
+GpsService::~GpsService()
+{
+    stop();
+}
+
+bool GpsService::start(unsigned int rate_hz)
+{
+    if (running)
+        return true;
+
+    if (rate_hz == 0 || rate_hz > GPS_MAX_RATE_HZ) {
+        fprintf(stderr, "GPS rate must be 1 to %d Hz\n", GPS_MAX_RATE_HZ);
+        return false;
+    }
+    period_ms = 1000 / rate_hz;
+
+    if (!configure())
+        return false;
+
+    running = true;
+    if (pthread_create(&thread, NULL, run, this) != 0) {
+        fprintf(stderr, "Failed to start GPS thread\n");
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void GpsService::stop()
+{
+    if (!running)
+        return;
+
+    running = false;
+    pthread_join(thread, NULL);
+}
+
+uint64_t GpsService::get_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* NAV-PVT on every solution replaces NAV-POSLLH and NAV-STATUS */
+bool GpsService::configure()
+{
+    if (ublox.setMeasurementRate(period_ms) < 0 ||
+        ublox.enableMessage(UBXNavPVT::ID, 1) < 0) {
+        fprintf(stderr, "Could not configure ublox over SPI\n");
+        return false;
+    }
+    return true;
+}
+
+void GpsService::on_pvt(void *arg, const UBXNavPVT *pvt)
+{
+    GpsService *service = (GpsService *)arg;
+    service->push(pvt, get_time_us());
+}
+
+void GpsService::push(const UBXNavPVT *pvt, uint64_t timestamp)
+{
+    unsigned int seq = head + 1;
+    Slot &slot = ring[seq % GPS_RING_SIZE];
+
+    slot.seq++;
+    __sync_synchronize();
+    slot.fix.timestamp = timestamp;
+    slot.fix.seq = seq;
+    memcpy(&slot.fix.pvt, pvt, sizeof(slot.fix.pvt));
+    __sync_synchronize();
+    slot.seq++;
+    __sync_synchronize();
+    head = seq;
+}
+
+/* false if the slot of fix seq is being written or already holds a newer fix */
+bool GpsService::read_slot(unsigned int seq, GpsFix *fix)
+{
+    Slot &slot = ring[seq % GPS_RING_SIZE];
+    unsigned int slot_seq;
+
+    do {
+        slot_seq = slot.seq;
+        __sync_synchronize();
+        *fix = slot.fix;
+        __sync_synchronize();
+    } while ((slot_seq & 1) || slot_seq != slot.seq);
+
+    return fix->seq == seq;
+}
+
+bool GpsService::get_latest(GpsFix *fix)
+{
+    for (;;) {
+        unsigned int seq = head;
+        if (seq == 0)
+            return false;
+        // A newer fix may have taken the slot meanwhile, start over from it
+        if (read_slot(seq, fix))
+            return true;
+    }
+}
+
+unsigned int GpsService::get_fixes(unsigned int seq, GpsFix *fixes, unsigned int max)
+{
+    unsigned int last = head;
+    unsigned int count = 0;
+
+    if (last - seq > GPS_RING_SIZE)
+        seq = last - GPS_RING_SIZE;
+
+    while (seq != last && count < max) {
+        seq++;
+        if (read_slot(seq, &fixes[count]))
+            count++;
+    }
+    return count;
+}
+
+void *GpsService::run(void *arg)
+{
+    ((GpsService *)arg)->loop();
+    return NULL;
+}
+
+void GpsService::loop()
+{
+    // Per thread nice value on Linux, the control loop keeps the CPU when it needs it
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), GPS_THREAD_NICE) < 0)
+        fprintf(stderr, "Failed to lower GPS thread priority\n");
+
+    uint64_t timeout_us = 3 * period_ms * 1000 + 1000000;
+    uint64_t last_fix = get_time_us();
+    unsigned int last_head = head;
+
+    while (running) {
+        bool idle;
+        int count = ublox.pollMessages(dispatcher, &idle);
+        uint64_t now = get_time_us();
+
+        if (head != last_head) {
+            last_head = head;
+            last_fix = now;
+        } else if (now - last_fix > timeout_us) {
+            configure();
+            last_fix = now;
+        }
+
+        if (count < 0) {
+            errors++;
+            usleep(spi_idle_us);
+        } else if (idle) {
+            // Nothing until the next solution, the receiver buffers meanwhile
+            usleep(spi_idle_us);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include "Ublox.h"
+
+#define GPS_RING_SIZE           16      // fixes kept for readers
+#define GPS_DEFAULT_RATE_HZ     5
+#define GPS_MAX_RATE_HZ         10
+#define GPS_THREAD_NICE         10      // below the control and sensor threads
+
+/* One NAV-PVT solution as received from the receiver */
+struct GpsFix {
+    uint64_t timestamp;                 // us, CLOCK_MONOTONIC, when the message was read
+    unsigned int seq;                   // number of fixes so far, starts at 1
+    UBXNavPVT pvt;
+};
+
+/* Owns the u-blox receiver on a low priority thread. The receiver is
+   configured for NAV-PVT at rate_hz and every solution is stored with its
+   receive time in a ring buffer. There is a single writer, readers take
+   the latest fix or the fixes since the last one they saw without locks
+   and without touching SPI. The configuration is sent again if the
+   receiver stays silent, e.g. after a reset. */
+class GpsService
+{
+public:
+    GpsService(std::string device = "/dev/spidev0.0");
+    ~GpsService();
+
+    bool start(unsigned int rate_hz = GPS_DEFAULT_RATE_HZ);
+    void stop();
+    bool is_running() const { return running; }
+
+    // false if there was no fix yet
+    bool get_latest(GpsFix *fix);
+    // Copies up to max fixes newer than seq, oldest first, fixes already
+    // overwritten in the ring are skipped. Returns the number copied.
+    unsigned int get_fixes(unsigned int seq, GpsFix *fixes, unsigned int max);
+    unsigned int get_fix_count() const { return head; }
+    unsigned int get_error_count() const { return errors; }
+
+    static uint64_t get_time_us();
+
+private:
+    struct Slot {
+        volatile unsigned int seq;      // odd while the fix is being written
+        GpsFix fix;
+    };
+
+    GpsService(const GpsService&);
+    GpsService& operator=(const GpsService&);
+
+    bool configure();
+    void push(const UBXNavPVT *pvt, uint64_t timestamp);
+    bool read_slot(unsigned int seq, GpsFix *fix);
+    static void on_pvt(void *arg, const UBXNavPVT *pvt);
+    static void *run(void *arg);
+    void loop();
+
+    Ublox ublox;
+    UBXDispatcher dispatcher;
+
+    Slot ring[GPS_RING_SIZE];
+    volatile unsigned int head;         // fixes published
+    volatile unsigned int errors;       // failed SPI transfers
+
+    unsigned int period_ms;
+    volatile bool running;
+    pthread_t thread;
+};
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+#include "I2Cdev.h"
+#include "I2Cbus.h"
+
+I2Cbus::I2Cbus(const char *device) :
+    device(device),
+    fd(-1),
+    selected_addr(-1),
+    rdwr(false)
+{
+    pthread_mutex_init(&lock, NULL);
+}
+
+I2Cbus::~I2Cbus()
+{
+    close();
+    pthread_mutex_destroy(&lock);
+}
+
+I2Cbus& I2Cbus::get()
+{
+    static I2Cbus bus(I2CDEV);
+    return bus;
+}
+
+bool I2Cbus::open()
+{
+    if (fd >= 0)
+        return true;
+
+    fd = ::open(device.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
+        return false;
+    }
+
+    unsigned long funcs = 0;
+    rdwr = ioctl(fd, I2C_FUNCS, &funcs) == 0 && (funcs & I2C_FUNC_I2C);
+    selected_addr = -1;
+    return true;
+}
+
+void I2Cbus::close()
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/* Only used without I2C_RDWR, which carries the address in every message */
+bool I2Cbus::select(uint8_t addr)
+{
+    if (selected_addr == addr)
+        return true;
+
+    if (ioctl(fd, I2C_SLAVE, addr) < 0) {
+        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
+        selected_addr = -1;
+        return false;
+    }
+    selected_addr = addr;
+    return true;
+}
+
+int I2Cbus::transfer(struct i2c_msg *msgs, unsigned int count)
+{
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = msgs;
+    data.nmsgs = count;
+
+    pthread_mutex_lock(&lock);
+    int ret = -1;
+    if (open() && !rdwr) {
+        fprintf(stderr, "Combined transfers are not supported by %s\n", device.c_str());
+    } else if (fd >= 0) {
+        ret = ioctl(fd, I2C_RDWR, &data);
+        if (ret < 0)
+            fprintf(stderr, "Failed to transfer on device: %s\n", strerror(errno));
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+int I2Cbus::read(uint8_t addr, uint8_t reg, uint8_t *data, unsigned int length)
+{
+    int count = -1;
+
+    pthread_mutex_lock(&lock);
+    if (!open()) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    if (rdwr) {
+        struct i2c_msg msgs[2];
+        msgs[0].addr = addr;
+        msgs[0].flags = 0;
+        msgs[0].len = 1;
+        msgs[0].buf = &reg;
+        msgs[1].addr = addr;
+        msgs[1].flags = I2C_M_RD;
+        msgs[1].len = length;
+        msgs[1].buf = data;
+
+        struct i2c_rdwr_ioctl_data rdwr_data = {msgs, 2};
+        if (ioctl(fd, I2C_RDWR, &rdwr_data) == 2)
+            count = length;
+        else
+            fprintf(stderr, "Failed to read device: %s\n", strerror(errno));
+    } else if (select(addr)) {
+        if (::write(fd, &reg, 1) != 1) {
+            fprintf(stderr, "Failed to write reg: %s\n", strerror(errno));
+        } else {
+            count = ::read(fd, data, length);
+            if (count < 0)
+                fprintf(stderr, "Failed to read device(%d): %s\n", count, strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (count >= 0 && count != (int)length) {
+        fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
+        return -1;
+    }
+    return count;
+}
+
+int I2Cbus::read(uint8_t addr, uint8_t *data, unsigned int length)
+{
+    int count = -1;
+
+    pthread_mutex_lock(&lock);
+    if (!open()) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    if (rdwr) {
+        struct i2c_msg msg;
+        msg.addr = addr;
+        msg.flags = I2C_M_RD;
+        msg.len = length;
+        msg.buf = data;
+
+        struct i2c_rdwr_ioctl_data rdwr_data = {&msg, 1};
+        if (ioctl(fd, I2C_RDWR, &rdwr_data) == 1)
+            count = length;
+        else
+            fprintf(stderr, "Failed to read device: %s\n", strerror(errno));
+    } else if (select(addr)) {
+        count = ::read(fd, data, length);
+        if (count < 0)
+            fprintf(stderr, "Failed to read device(%d): %s\n", count, strerror(errno));
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (count >= 0 && count != (int)length) {
+        fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
+        return -1;
+    }
+    return count;
+}
+
+int I2Cbus::write(uint8_t addr, uint8_t reg, const uint8_t *data, unsigned int length)
+{
+    uint8_t buf[MAX_WRITE];
+    int count = -1;
+
+    if (length > MAX_WRITE - 1) {
+        fprintf(stderr, "Byte write count (%d) > %d\n", length, MAX_WRITE - 1);
+        return -1;
+    }
+
+    buf[0] = reg;
+    if (length > 0)
+        memcpy(buf + 1, data, length);
+
+    pthread_mutex_lock(&lock);
+    if (!open()) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    if (rdwr) {
+        struct i2c_msg msg;
+        msg.addr = addr;
+        msg.flags = 0;
+        msg.len = length + 1;
+        msg.buf = buf;
+
+        struct i2c_rdwr_ioctl_data rdwr_data = {&msg, 1};
+        if (ioctl(fd, I2C_RDWR, &rdwr_data) == 1)
+            count = length + 1;
+        else
+            fprintf(stderr, "Failed to write device: %s\n", strerror(errno));
+    } else if (select(addr)) {
+        count = ::write(fd, buf, length + 1);
+        if (count < 0)
+            fprintf(stderr, "Failed to write device(%d): %s\n", count, strerror(errno));
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (count >= 0 && count != (int)length + 1) {
+        fprintf(stderr, "Short write to device, expected %d, got %d\n", length + 1, count);
+        return -1;
+    }
+    return count < 0 ? -1 : length;
+}
@@ -0,0 +1,51 @@
+#ifndef _I2CBUS_H_
+#define _I2CBUS_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <linux/i2c.h>
+
+/* Persistent handle on an I2C adapter. The device is opened on first use and
+   kept open. Register reads are issued as one I2C_RDWR message pair, the
+   register address write and the data read joined by a repeated start.
+   Adapters without plain I2C support fall back to read()/write() on the fd,
+   with the slave address selected by I2C_SLAVE only when it changes.
+   All accesses are serialized, so drivers in different threads can share
+   the bus. */
+class I2Cbus {
+public:
+    static const unsigned int MAX_WRITE = 128;
+
+    I2Cbus(const char *device);
+    ~I2Cbus();
+
+    // Shared bus on the default adapter, used by I2Cdev
+    static I2Cbus& get();
+
+    bool open();
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // return the number of bytes transferred or -1 on error
+    int read(uint8_t addr, uint8_t reg, uint8_t *data, unsigned int length);
+    int read(uint8_t addr, uint8_t *data, unsigned int length);
+    int write(uint8_t addr, uint8_t reg, const uint8_t *data, unsigned int length);
+
+    // Issues msgs as one combined transaction, returns -1 on error
+    int transfer(struct i2c_msg *msgs, unsigned int count);
+
+private:
+    I2Cbus(const I2Cbus&);
+    I2Cbus& operator=(const I2Cbus&);
+
+    bool select(uint8_t addr);
+
+    std::string device;
+    int fd;
+    int selected_addr;
+    bool rdwr;
+    pthread_mutex_t lock;
+};
+
+#endif /* _I2CBUS_H_ */
@@ -53,6 +53,7 @@ THE SOFTWARE.
 #include <sys/stat.h>
 #include <linux/i2c-dev.h>
 #include "I2Cdev.h"
+#include "I2Cbus.h"
 
 /** Default constructor.
  */
@@ -171,37 +172,7 @@ int8_t I2Cdev::readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data, uint16
  * @return Number of bytes read (-1 indicates failure)
  */
 int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
-    int8_t count = 0;
-    int fd = open(I2CDEV, O_RDWR);
-
-    if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(-1);
-    }
-    if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return(-1);
-    }
-    if (write(fd, &regAddr, 1) != 1) {
-        fprintf(stderr, "Failed to write reg: %s\n", strerror(errno));
-        close(fd);
-        return(-1);
-    }
-    count = read(fd, data, length);
-
-    if (count < 0) {
-        fprintf(stderr, "Failed to read device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
-        return(-1);
-    } else if (count != length) {
-        fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
-        close(fd);
-        return(-1);
-    }
-    close(fd);
-
-    return count;
+    return I2Cbus::get().read(devAddr, regAddr, data, length);
 }
 
 /** Read multiple bytes from an 8-bit device register without sending the register address. Required by MB85RC256(FRAM on Navio+)
@@ -213,32 +184,7 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
  * @return Number of bytes read (-1 indicates failure)
  */
 int8_t I2Cdev::readBytesNoRegAddress(uint8_t devAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
-    int8_t count = 0;
-    int fd = open(I2CDEV, O_RDWR);
-
-    if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(-1);
-    }
-    if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return(-1);
-    }
-    count = read(fd, data, length);
-
-    if (count < 0) {
-        fprintf(stderr, "Failed to read device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
-        return(-1);
-    } else if (count != length) {
-        fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
-        close(fd);
-        return(-1);
-    }
-    close(fd);
-
-    return count;
+    return I2Cbus::get().read(devAddr, data, length);
 }
 
 /** Read multiple words from a 16-bit device register.
@@ -369,40 +315,12 @@ bool I2Cdev::writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data) {
  * @return Status of operation (true = success)
  */
 bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data) {
-    int8_t count = 0;
-    uint8_t buf[128];
-    int fd;
-
     if (length > 127) {
         fprintf(stderr, "Byte write count (%d) > 127\n", length);
         return(FALSE);
     }
 
-    fd = open(I2CDEV , O_RDWR);
-    if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(FALSE);
-    }
-    if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return(FALSE);
-    }
-    buf[0] = regAddr;
-    memcpy(buf+1,data,length);
-    count = write(fd, buf, length+1);
-    if (count < 0) {
-        fprintf(stderr, "Failed to write device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
-        return(FALSE);
-    } else if (count != length+1) {
-        fprintf(stderr, "Short write to device, expected %d, got %d\n", length+1, count);
-        close(fd);
-        return(FALSE);
-    }
-    close(fd);
-
-    return TRUE;
+    return I2Cbus::get().write(devAddr, regAddr, data, length) >= 0;
 }
 
 /** Write multiple words to a 16-bit device register.
@@ -413,9 +331,8 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
  * @return Status of operation (true = success)
  */
 bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t* data) {
-    int8_t count = 0;
     uint8_t buf[128];
-    int i, fd;
+    int i;
 
     // Should do potential byteswap and call writeBytes() really, but that
     // messes with the callers buffer
@@ -425,33 +342,12 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
         return(FALSE);
     }
 
-    fd = open(I2CDEV, O_RDWR);
-    if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(FALSE);
-    }
-    if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return(FALSE);
-    }
-    buf[0] = regAddr;
     for (i = 0; i < length; i++) {
-        buf[i*2+1] = data[i] >> 8;
-        buf[i*2+2] = data[i];
+        buf[i*2] = data[i] >> 8;
+        buf[i*2+1] = data[i];
     }
-    count = write(fd, buf, length*2+1);
-    if (count < 0) {
-        fprintf(stderr, "Failed to write device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
-        return(FALSE);
-    } else if (count != length*2+1) {
-        fprintf(stderr, "Short write to device, expected %d, got %d\n", length+1, count);
-        close(fd);
-        return(FALSE);
-    }
-    close(fd);
-    return TRUE;
+
+    return I2Cbus::get().write(devAddr, regAddr, buf, length*2) >= 0;
 }
 
 /** Default timeout value for read operations.
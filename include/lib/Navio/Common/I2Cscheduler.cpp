@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "I2Cscheduler.h"
+
+void I2Cresult::complete(void *arg, int status, const uint8_t *data, unsigned int length)
+{
+    I2Cresult *result = (I2Cresult *)arg;
+
+    result->status = status;
+    if (status > 0 && data != NULL)
+        memcpy(result->data, data, length);
+    // publish status and data before the flag
+    __sync_synchronize();
+    result->done = true;
+}
+
+I2Cscheduler::I2Cscheduler(I2Cbus &bus) :
+    bus(bus),
+    count(0),
+    seq(0),
+    running(false)
+{
+    memset(queue, 0, sizeof(queue));
+    pthread_mutex_init(&lock, NULL);
+
+    // Timed waits use the monotonic clock like get_time_us()
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+I2Cscheduler::~I2Cscheduler()
+{
+    stop();
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+I2Cscheduler& I2Cscheduler::get()
+{
+    static I2Cscheduler scheduler(I2Cbus::get());
+    scheduler.start();
+    return scheduler;
+}
+
+bool I2Cscheduler::start()
+{
+    pthread_mutex_lock(&lock);
+    if (running) {
+        pthread_mutex_unlock(&lock);
+        return true;
+    }
+    running = true;
+    pthread_mutex_unlock(&lock);
+
+    if (pthread_create(&thread, NULL, run, this) != 0) {
+        fprintf(stderr, "Failed to start I2C scheduler thread\n");
+        pthread_mutex_lock(&lock);
+        running = false;
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    return true;
+}
+
+void I2Cscheduler::stop()
+{
+    pthread_mutex_lock(&lock);
+    if (!running) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    running = false;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);
+
+    // Fail what is left so that no client keeps waiting for it, callbacks
+    // run without the lock like on the worker and cannot queue new requests
+    for (unsigned int i = 0; i < I2C_SCHED_MAX_PENDING; i++) {
+        pthread_mutex_lock(&lock);
+        Request request = queue[i];
+        if (request.used) {
+            queue[i].used = false;
+            count--;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (request.used && request.callback != NULL)
+            request.callback(request.arg, -1, NULL, request.length);
+    }
+}
+
+uint64_t I2Cscheduler::get_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned int I2Cscheduler::pending()
+{
+    pthread_mutex_lock(&lock);
+    unsigned int n = count;
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+bool I2Cscheduler::read(I2Cpriority priority, uint8_t addr, uint8_t reg, unsigned int length,
+                        I2Ccallback callback, void *arg, uint64_t not_before_us)
+{
+    return submit(true, false, priority, addr, reg, NULL, length, callback, arg, not_before_us);
+}
+
+bool I2Cscheduler::write(I2Cpriority priority, uint8_t addr, uint8_t reg,
+                         const uint8_t *data, unsigned int length,
+                         I2Ccallback callback, void *arg, uint64_t not_before_us)
+{
+    return submit(false, false, priority, addr, reg, data, length, callback, arg, not_before_us);
+}
+
+bool I2Cscheduler::read16(I2Cpriority priority, uint8_t addr, uint16_t reg, unsigned int length,
+                          I2Ccallback callback, void *arg, uint64_t not_before_us)
+{
+    return submit(true, true, priority, addr, reg, NULL, length, callback, arg, not_before_us);
+}
+
+bool I2Cscheduler::write16(I2Cpriority priority, uint8_t addr, uint16_t reg,
+                           const uint8_t *data, unsigned int length,
+                           I2Ccallback callback, void *arg, uint64_t not_before_us)
+{
+    return submit(false, true, priority, addr, reg, data, length, callback, arg, not_before_us);
+}
+
+bool I2Cscheduler::submit(bool is_read, bool reg16, I2Cpriority priority, uint8_t addr, uint16_t reg,
+                          const uint8_t *data, unsigned int length,
+                          I2Ccallback callback, void *arg, uint64_t not_before_us)
+{
+    if (length > I2C_SCHED_MAX_DATA) {
+        fprintf(stderr, "I2C request length (%d) > %d\n", length, I2C_SCHED_MAX_DATA);
+        return false;
+    }
+
+    // Nothing would run the request without the worker
+    pthread_mutex_lock(&lock);
+    if (!running || count >= I2C_SCHED_MAX_PENDING) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+    unsigned int i = 0;
+    while (queue[i].used)
+        i++;
+
+    Request &request = queue[i];
+    request.used = true;
+    request.is_read = is_read;
+    request.reg16 = reg16;
+    request.priority = priority;
+    request.addr = addr;
+    request.reg = reg;
+    request.length = length;
+    request.seq = seq++;
+    request.not_before_us = not_before_us;
+    request.callback = callback;
+    request.arg = arg;
+    if (!is_read && length > 0)
+        memcpy(request.data, data, length);
+    count++;
+
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+/* Picks the request to run now, or sets wake_us to the earliest time a held
+   back request becomes ready. Called with the lock held. */
+int I2Cscheduler::next(uint64_t now, uint64_t *wake_us)
+{
+    int best = -1;
+
+    *wake_us = 0;
+    for (unsigned int i = 0; i < I2C_SCHED_MAX_PENDING; i++) {
+        const Request &request = queue[i];
+        if (!request.used)
+            continue;
+
+        if (request.not_before_us > now) {
+            if (*wake_us == 0 || request.not_before_us < *wake_us)
+                *wake_us = request.not_before_us;
+            continue;
+        }
+
+        if (best < 0 || request.priority < queue[best].priority ||
+            (request.priority == queue[best].priority && request.seq < queue[best].seq))
+            best = i;
+    }
+    return best;
+}
+
+/* Runs one request on the bus, returns the number of bytes transferred or -1 */
+int I2Cscheduler::transfer(Request &request)
+{
+    if (!request.reg16) {
+        if (request.is_read)
+            return bus.read(request.addr, request.reg, request.data, request.length);
+        return bus.write(request.addr, request.reg, request.data, request.length);
+    }
+
+    uint8_t reg[2 + I2C_SCHED_MAX_DATA];
+    reg[0] = request.reg >> 8;
+    reg[1] = request.reg & 0xFF;
+
+    if (!request.is_read) {
+        // The low address byte leads the data
+        memcpy(reg + 2, request.data, request.length);
+        return bus.write(request.addr, reg[0], reg + 1, request.length + 1) < 0 ? -1 : request.length;
+    }
+
+    // Address write and data read joined by a repeated start
+    struct i2c_msg msgs[2];
+    msgs[0].addr = request.addr;
+    msgs[0].flags = 0;
+    msgs[0].len = 2;
+    msgs[0].buf = reg;
+    msgs[1].addr = request.addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = request.length;
+    msgs[1].buf = request.data;
+    return bus.transfer(msgs, 2) == 2 ? (int)request.length : -1;
+}
+
+void *I2Cscheduler::run(void *arg)
+{
+    ((I2Cscheduler *)arg)->loop();
+    return NULL;
+}
+
+void I2Cscheduler::loop()
+{
+    Request request;
+
+    pthread_mutex_lock(&lock);
+    while (running) {
+        uint64_t wake_us;
+        int i = next(get_time_us(), &wake_us);
+
+        if (i < 0) {
+            if (wake_us == 0) {
+                pthread_cond_wait(&cond, &lock);
+            } else {
+                struct timespec ts;
+                ts.tv_sec = wake_us / 1000000;
+                ts.tv_nsec = (wake_us % 1000000) * 1000;
+                pthread_cond_timedwait(&cond, &lock, &ts);
+            }
+            continue;
+        }
+
+        // Run the transfer and the callback without the lock, clients keep queueing
+        request = queue[i];
+        queue[i].used = false;
+        count--;
+        pthread_mutex_unlock(&lock);
+
+        int status = transfer(request);
+        if (request.callback != NULL)
+            request.callback(request.arg, status, request.data, request.length);
+
+        pthread_mutex_lock(&lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
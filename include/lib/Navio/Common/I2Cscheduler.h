@@ -0,0 +1,109 @@
+#ifndef _I2CSCHEDULER_H_
+#define _I2CSCHEDULER_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "I2Cbus.h"
+
+#define I2C_SCHED_MAX_DATA      64      // bytes per request, a PCA9685 burst of all channels
+#define I2C_SCHED_MAX_PENDING   64      // queued requests
+
+enum I2Cpriority {
+    I2C_PRIORITY_HIGH = 0,              // actuators
+    I2C_PRIORITY_NORMAL,                // sensors, barometer
+    I2C_PRIORITY_LOW                    // ADC, FRAM logging
+};
+
+/* status is the number of bytes transferred or -1 on error, data holds the
+   bytes read and is only valid during the call */
+typedef void (*I2Ccallback)(void *arg, int status, const uint8_t *data, unsigned int length);
+
+/* Completion slot for callers that poll instead of using a callback. Pass
+   I2Cresult::complete as callback and the slot as arg. */
+struct I2Cresult {
+    volatile bool done;
+    int status;
+    uint8_t data[I2C_SCHED_MAX_DATA];
+
+    I2Cresult() : done(false), status(0) {}
+    void reset() { done = false; }
+    bool ready() { __sync_synchronize(); return done; }
+
+    static void complete(void *arg, int status, const uint8_t *data, unsigned int length);
+};
+
+/* Worker thread that owns the I2C bus traffic of its clients. Requests are
+   queued without blocking on the bus and executed highest priority first,
+   in submission order within a priority. A request can be held back until
+   a given time, e.g. the end of a conversion, without occupying the bus or
+   the caller. Transfers are not preempted, a low priority request already
+   on the bus delays the next one by its own duration only. Callbacks run
+   on the worker thread and must not block. */
+class I2Cscheduler {
+public:
+    I2Cscheduler(I2Cbus &bus);
+    ~I2Cscheduler();
+
+    // Shared scheduler on the default bus, started on first use
+    static I2Cscheduler& get();
+
+    bool start();
+    void stop();
+
+    // return false if the queue is full or the worker is not running,
+    // not_before_us is a get_time_us() time
+    bool read(I2Cpriority priority, uint8_t addr, uint8_t reg, unsigned int length,
+              I2Ccallback callback, void *arg, uint64_t not_before_us = 0);
+    bool write(I2Cpriority priority, uint8_t addr, uint8_t reg,
+               const uint8_t *data, unsigned int length,
+               I2Ccallback callback = NULL, void *arg = NULL, uint64_t not_before_us = 0);
+    // Same with a 16 bit register address sent high byte first, e.g. FRAM
+    // memory addresses. read16() is one combined transfer.
+    bool read16(I2Cpriority priority, uint8_t addr, uint16_t reg, unsigned int length,
+                I2Ccallback callback, void *arg, uint64_t not_before_us = 0);
+    bool write16(I2Cpriority priority, uint8_t addr, uint16_t reg,
+                 const uint8_t *data, unsigned int length,
+                 I2Ccallback callback = NULL, void *arg = NULL, uint64_t not_before_us = 0);
+
+    unsigned int pending();
+    static uint64_t get_time_us();
+
+private:
+    struct Request {
+        bool used;
+        bool is_read;
+        bool reg16;
+        uint8_t priority;
+        uint8_t addr;
+        uint16_t reg;
+        unsigned int length;
+        uint64_t seq;
+        uint64_t not_before_us;
+        I2Ccallback callback;
+        void *arg;
+        uint8_t data[I2C_SCHED_MAX_DATA];
+    };
+
+    I2Cscheduler(const I2Cscheduler&);
+    I2Cscheduler& operator=(const I2Cscheduler&);
+
+    bool submit(bool is_read, bool reg16, I2Cpriority priority, uint8_t addr, uint16_t reg,
+                const uint8_t *data, unsigned int length,
+                I2Ccallback callback, void *arg, uint64_t not_before_us);
+    int transfer(Request &request);
+    int next(uint64_t now, uint64_t *wake_us);
+    static void *run(void *arg);
+    void loop();
+
+    I2Cbus &bus;
+    Request queue[I2C_SCHED_MAX_PENDING];
+    unsigned int count;
+    uint64_t seq;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool running;
+};
+
+#endif /* _I2CSCHEDULER_H_ */
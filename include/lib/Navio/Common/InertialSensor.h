@@ -1,22 +1,135 @@
 #ifndef _INERTIAL_SENSOR_H
 #define _INERTIAL_SENSOR_H
 
+#include <stdint.h>
+#include <time.h>
+#include <stddef.h>
+#include "gpio.h"
+
+struct InertialSample {
+    uint64_t timestamp;         // monotonic time in microseconds
+    float temperature;
+    float ax, ay, az;
+    float gx, gy, gz;
+    float mx, my, mz;
+    bool mag_new;               // magnetometer values are a new measurement
+};
+
+// Raw channel order: accelerometer, gyroscope and magnetometer xyz, then temperature
+#define INERTIAL_RAW_CHANNELS   10
+#define INERTIAL_RAW_TEMP       9
+
+struct InertialRawSample {
+    uint64_t timestamp;         // monotonic time in microseconds
+    int16_t data[INERTIAL_RAW_CHANNELS];
+    bool mag_new;
+};
+
 class InertialSensor {
 public:
+    InertialSensor() : drdy_events(NULL), drdy_timestamp(0), _mag_new(true), _mag_timestamp(0) {};
+    virtual ~InertialSensor() {delete drdy_events;};
+
     virtual bool initialize() = 0;
     virtual bool probe() = 0;
     virtual void update() = 0;
 
+    // Runtime configuration, each returns the value actually set or 0 if not supported
+    virtual float set_sample_rate(unsigned int rate_hz) {return 0;};
+    virtual unsigned int set_lowpass(unsigned int bandwidth_hz) {return 0;};
+    virtual unsigned int set_accel_range(unsigned int range_g) {return 0;};
+    virtual unsigned int set_gyro_range(unsigned int range_dps) {return 0;};
+
+    // Sensors without a hardware FIFO keep sampling one frame per update()
+    virtual bool enable_fifo(unsigned int rate_hz) {return false;};
+    virtual int update_batch(InertialSample *samples, int max_samples)
+    {
+        if (max_samples < 1)
+            return 0;
+        update();
+        read_sample(&samples[0]);
+        samples[0].timestamp = take_sample_timestamp();
+        if (_mag_new)
+            _mag_timestamp = samples[0].timestamp;
+        return 1;
+    };
+
+    // Raw path: samples in sensor LSB, converted by the caller with get_raw_scale().
+    // Axes follow the MPU9250 convention. Returns -1 if the sensor has no raw path
+    virtual int update_raw_batch(InertialRawSample *samples, int max_samples) {return -1;};
+    // SI scale per LSB of the 9 motion channels (m/s^2, rad/s, uT)
+    virtual void get_raw_scale(float scale[INERTIAL_RAW_TEMP]) {};
+
+    // Route the sensor data-ready interrupt to a gpio and pace reads on its edges
+    virtual bool enable_data_ready(uint8_t pin, unsigned int rate_hz) {return false;};
+    // Edges queued while the caller was late are dropped, the next read returns
+    // the newest sample and gets the kernel timestamp of its edge
+    bool wait_data_ready(int timeout_ms)
+    {
+        Navio::GpioEvent event;
+        if (drdy_events == NULL || drdy_events->wait(&event, timeout_ms) != 1)
+            return false;
+        while (drdy_events->read(&event, 1) == 1)
+            ;
+        drdy_timestamp = event.timestamp / 1000;
+        return true;
+    };
+
     float read_temperature() {return temperature;};
     void read_accelerometer(float *ax, float *ay, float *az) {*ax = _ax; *ay = _ay; *az = _az;};
     void read_gyroscope(float *gx, float *gy, float *gz) {*gx = _gx; *gy = _gy; *gz = _gz;};
     void read_magnetometer(float *mx, float *my, float *mz) {*mx = _mx; *my = _my; *mz = _mz;};
+    // Magnetometers run slower than accel/gyro, these tell whether the last update brought new values
+    bool is_magnetometer_new() {return _mag_new;};
+    uint64_t read_magnetometer_timestamp() {return _mag_timestamp;};
+    void read_sample(InertialSample *s)
+    {
+        s->temperature = temperature;
+        s->ax = _ax; s->ay = _ay; s->az = _az;
+        s->gx = _gx; s->gy = _gy; s->gz = _gz;
+        s->mx = _mx; s->my = _my; s->mz = _mz;
+        s->mag_new = _mag_new;
+    };
+
+    static uint64_t get_timestamp_us()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    };
 
 protected:
+    bool attach_data_ready(uint8_t pin)
+    {
+        delete drdy_events;
+        drdy_timestamp = 0;
+        drdy_events = new Navio::GpioEdgeEvents(pin);
+        if (!drdy_events->open(Navio::Pin::GpioEdgeRising)) {
+            delete drdy_events;
+            drdy_events = NULL;
+            return false;
+        }
+        return true;
+    };
+
+    // Time of the data-ready edge of the sample being read, now if there is none.
+    // Each edge stamps one sample only
+    uint64_t take_sample_timestamp()
+    {
+        uint64_t timestamp = drdy_timestamp;
+        drdy_timestamp = 0;
+        return timestamp ? timestamp : get_timestamp_us();
+    };
+
+    Navio::GpioEdgeEvents *drdy_events;
+    uint64_t drdy_timestamp;
+
     float temperature;
     float _ax, _ay, _az;
     float _gx, _gy, _gz;
     float _mx, _my, _mz;
+    bool _mag_new;
+    uint64_t _mag_timestamp;
 };
 
 #endif //_INERTIAL_SENSOR_H
@@ -3,6 +3,7 @@ Written by Qiyong Mu (kylongmu@msn.com)
 Adapted for Raspberry Pi by Mikhail Avkhimenia (mikhail.avkhimenia@emlid.com)
 */
 
+#include <stdio.h>
 #include "MPU9250.h"
 
 #define G_SI 9.80665
@@ -10,8 +11,17 @@ Adapted for Raspberry Pi by Mikhail Avkhimenia (mikhail.avkhimenia@emlid.com)
 
 //-----------------------------------------------------------------------------------------------
 
-MPU9250::MPU9250()
+MPU9250::MPU9250() :
+    spi("/dev/spidev0.1", MPU9250_SPI_SLOW_HZ, MPU9250_SPI_FAST_HZ),
+    sample_rate_hz(8000),
+    dlpf_cfg(BITS_DLPF_CFG_188HZ),
+    fifo_enabled(false),
+    fifo_frame_size(0),
+    fifo_period_us(0)
 {
+    memset(mag_last, 0, sizeof(mag_last));
+    memset(fifo_tx, 0, sizeof(fifo_tx));
+    fifo_tx[0] = MPUREG_FIFO_R_W | READ_FLAG;
 }
 
 /*-----------------------------------------------------------------------------------------------
@@ -24,7 +34,7 @@ unsigned int MPU9250::WriteReg(uint8_t WriteAddr, uint8_t WriteData)
     unsigned char tx[2] = {WriteAddr, WriteData};
     unsigned char rx[2] = {0};
 
-    SPIdev::transfer("/dev/spidev0.1", tx, rx, 2);
+    spi.transfer(tx, rx, 2);
 
     return rx[1];
 }
@@ -47,7 +57,7 @@ void MPU9250::ReadRegs(uint8_t ReadAddr, uint8_t *ReadBuf, unsigned int Bytes)
 
     tx[0] = ReadAddr | READ_FLAG;
 
-    SPIdev::transfer("/dev/spidev0.1", tx, rx, Bytes + 1);
+    spi.transfer(tx, rx, Bytes + 1);
 
     for(i=0; i<Bytes; i++)
         ReadBuf[i] = rx[i + 1];
@@ -75,6 +85,8 @@ bool MPU9250::probe()
     usleep(10000);
     responseM = ReadReg(MPUREG_EXT_SENS_DATA_00);
 
+    start_mag_autoread();
+
     if (responseXG == 0x71 && responseM == 0x48)
         return true;
     else
@@ -124,7 +136,7 @@ bool MPU9250::initialize()
         {0x81, MPUREG_I2C_SLV0_CTRL},  //Enable I2C and set 1 byte
 
         {AK8963_CNTL1, MPUREG_I2C_SLV0_REG}, //I2C slave 0 register address from where to begin data transfer
-        {0x12, MPUREG_I2C_SLV0_DO}, // Register value to continuous measurement in 16bit
+        {AK8963_CNTL1_16BIT_100HZ, MPUREG_I2C_SLV0_DO}, // Register value to continuous measurement 2 (100Hz) in 16bit
         {0x81, MPUREG_I2C_SLV0_CTRL}  //Enable I2C and set 1 byte
 
     };
@@ -138,6 +150,7 @@ bool MPU9250::initialize()
     }
 
     calib_mag();
+    start_mag_autoread();
     return 0;
 }
 /*-----------------------------------------------------------------------------------------------
@@ -289,48 +302,396 @@ void MPU9250::calib_mag()
     }
 }
 
+/*-----------------------------------------------------------------------------------------------
+                                MAGNETOMETER AUTO READ
+usage: called once after the AK8963 is configured. I2C slave 0 then keeps copying ST1 to ST2 into
+EXT_SENS_DATA on its own, so update() only reads registers. Reading up to ST2 unlatches the
+AK8963 data registers for the next measurement.
+-----------------------------------------------------------------------------------------------*/
+
+void MPU9250::start_mag_autoread()
+{
+    WriteReg(MPUREG_I2C_SLV0_ADDR, AK8963_I2C_ADDR | READ_FLAG);
+    WriteReg(MPUREG_I2C_SLV0_REG, AK8963_ST1);
+    WriteReg(MPUREG_I2C_SLV0_CTRL, BIT_I2C_SLV_EN | MPU9250_MAG_BYTES);
+    set_mag_read_rate();
+}
+
+//-----------------------------------------------------------------------------------------------
+
+void MPU9250::set_mag_read_rate()
+{
+    // Slave 0 is read every (1 + I2C_MST_DLY) samples, poll the AK8963 at MPU9250_MAG_READ_HZ
+    int delay = (int)(sample_rate_hz / MPU9250_MAG_READ_HZ) - 1;
+    if (delay < 0)
+        delay = 0;
+    if (delay > BITS_I2C_MST_DLY_MASK)
+        delay = BITS_I2C_MST_DLY_MASK;
+
+    WriteReg(MPUREG_I2C_SLV4_CTRL, delay);
+    WriteReg(MPUREG_I2C_MST_DELAY_CTRL, BIT_SLV0_DLY_EN);
+}
+
 
 //-----------------------------------------------------------------------------------------------
 
 void MPU9250::update()
 {
-    uint8_t response[21];
-    int16_t bit_data[3];
-    int i;
+    uint8_t response[14 + MPU9250_MAG_BYTES];
+    int16_t data[INERTIAL_RAW_CHANNELS];
 
-    //Send I2C command at first
-    WriteReg(MPUREG_I2C_SLV0_ADDR, AK8963_I2C_ADDR | READ_FLAG); //Set the I2C slave addres of AK8963 and set for read.
-    WriteReg(MPUREG_I2C_SLV0_REG, AK8963_HXL); //I2C slave 0 register address from where to begin data transfer
-    WriteReg(MPUREG_I2C_SLV0_CTRL, 0x87); //Read 7 bytes from the magnetometer
-    //must start your read from AK8963A register 0x03 and read seven bytes so that upon read of ST2 register 0x09 the AK8963A will unlatch the data registers for the next measurement.
+    // The magnetometer is polled by the I2C master, a plain register read gets the whole sample
+    SPItransaction transaction(spi);
+    transaction.read(MPUREG_ACCEL_XOUT_H | READ_FLAG, response, sizeof(response));
 
-    ReadRegs(MPUREG_ACCEL_XOUT_H, response, 21);
+    if (transaction.submit() < 0)
+        return;
+
+    _mag_new = decode_raw(response, data);
+    if (_mag_new)
+        _mag_timestamp = get_timestamp_us();
+    apply_raw(data);
+}
+
+//-----------------------------------------------------------------------------------------------
+
+bool MPU9250::decode_raw(const uint8_t *response, int16_t *data)
+{
+    int i;
 
     //Get accelerometer value
     for(i=0; i<3; i++) {
-        bit_data[i] = ((int16_t)response[i*2] << 8) | response[i*2+1];
+        data[i] = ((int16_t)response[i*2] << 8) | response[i*2+1];
     }
-    _ax = G_SI * bit_data[0] / acc_divider;
-    _ay = G_SI * bit_data[1] / acc_divider;
-    _az = G_SI * bit_data[2] / acc_divider;
 
     //Get temperature
-    bit_data[0] = ((int16_t)response[i*2] << 8) | response[i*2+1];
-    temperature = ((bit_data[0] - 21) / 333.87) + 21;
+    data[INERTIAL_RAW_TEMP] = ((int16_t)response[6] << 8) | response[7];
 
     //Get gyroscope value
     for(i=4; i<7; i++) {
-        bit_data[i-4] = ((int16_t)response[i*2] << 8) | response[i*2+1];
+        data[i-1] = ((int16_t)response[i*2] << 8) | response[i*2+1];
     }
-    _gx = (PI / 180) * bit_data[0] / gyro_divider;
-    _gy = (PI / 180) * bit_data[1] / gyro_divider;
-    _gz = (PI / 180) * bit_data[2] / gyro_divider;
 
-    //Get Magnetometer value
+    //Get Magnetometer value, response[14] holds ST1
     for(i=7; i<10; i++) {
-        bit_data[i-7] = ((int16_t)response[i*2+1] << 8) | response[i*2];
+        data[i-1] = ((int16_t)response[i*2+2] << 8) | response[i*2+1];
+    }
+
+    // The AK8963 runs slower than the I2C master polls it, and a copy in EXT_SENS_DATA stays
+    // there until the next poll. Only a ready measurement that differs from the last one is new.
+    const uint8_t *mag = &response[14];
+    if (!(mag[0] & AK8963_ST1_DRDY) || memcmp(mag, mag_last, sizeof(mag_last)) == 0)
+        return false;
+
+    memcpy(mag_last, mag, sizeof(mag_last));
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------
+
+void MPU9250::apply_raw(const int16_t *data)
+{
+    _ax = G_SI * data[0] / acc_divider;
+    _ay = G_SI * data[1] / acc_divider;
+    _az = G_SI * data[2] / acc_divider;
+
+    temperature = ((data[INERTIAL_RAW_TEMP] - 21) / 333.87) + 21;
+
+    _gx = (PI / 180) * data[3] / gyro_divider;
+    _gy = (PI / 180) * data[4] / gyro_divider;
+    _gz = (PI / 180) * data[5] / gyro_divider;
+
+    _mx = data[6] * magnetometer_ASA[0];
+    _my = data[7] * magnetometer_ASA[1];
+    _mz = data[8] * magnetometer_ASA[2];
+}
+
+//-----------------------------------------------------------------------------------------------
+
+void MPU9250::get_raw_scale(float scale[INERTIAL_RAW_TEMP])
+{
+    for (int i = 0; i < 3; i++) {
+        scale[i] = G_SI / acc_divider;
+        scale[i + 3] = (PI / 180) / gyro_divider;
+        scale[i + 6] = magnetometer_ASA[i];
+    }
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    FIFO MODE
+usage: call this function after initialize() to let the sensor queue samples in its hardware
+FIFO at rate_hz. Rates up to 1000 Hz queue accelerometer, temperature and gyroscope frames
+through the sample rate divider. Higher rates bypass the DLPF and queue gyroscope frames only at
+8 kHz, accelerometer and temperature are then taken from the data registers on every drain.
+The magnetometer keeps its own rate either way.
+returns true if FIFO mode was enabled
+-----------------------------------------------------------------------------------------------*/
+
+bool MPU9250::enable_fifo(unsigned int rate_hz)
+{
+    uint8_t fifo_mask;
+
+    if (rate_hz == 0)
+        return false;
+
+    WriteReg(MPUREG_FIFO_EN, 0x00);
+
+    float rate = set_sample_rate(rate_hz);
+    if (rate > 1000) {
+        fifo_mask = BITS_FIFO_GYRO;
+        fifo_frame_size = 6;
+    } else {
+        fifo_mask = BITS_FIFO_TEMP | BITS_FIFO_GYRO | BITS_FIFO_ACCEL;
+        fifo_frame_size = 14;
+    }
+    fifo_period_us = 1000000.0 / rate;
+
+    reset_fifo();
+    WriteReg(MPUREG_FIFO_EN, fifo_mask);
+
+    fifo_enabled = true;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    SAMPLE RATE
+usage: rates up to 1000 Hz use the DLPF chosen with set_lowpass() and the sample rate divider,
+higher rates bypass the DLPF and run the gyroscope at 8 kHz. The divider gives 1000 / (1 + n) Hz
+with n up to 255, the nearest of these rates is used and a different rate is reported.
+returns the sample rate set in Hz, 0 if rate_hz is 0
+-----------------------------------------------------------------------------------------------*/
+
+float MPU9250::set_sample_rate(unsigned int rate_hz)
+{
+    if (rate_hz == 0) {
+        fprintf(stderr, "MPU9250: sample rate must not be 0\n");
+        return 0;
+    }
+
+    if (rate_hz > 1000) {
+        WriteReg(MPUREG_CONFIG, BIT_FIFO_MODE_STOP | BITS_DLPF_CFG_2100HZ_NOLPF);
+        sample_rate_hz = 8000;
+    } else {
+        // n = 1000 / rate_hz - 1 samples at rate_hz or faster, n + 1 slower, take the closer one
+        unsigned int divider = 1000 / rate_hz - 1;
+        if (1000.0 / (divider + 1) - rate_hz > rate_hz - 1000.0 / (divider + 2))
+            divider++;
+        if (divider > 255)
+            divider = 255;
+
+        WriteReg(MPUREG_CONFIG, BIT_FIFO_MODE_STOP | dlpf_cfg);
+        WriteReg(MPUREG_SMPLRT_DIV, divider);
+        sample_rate_hz = 1000.0 / (divider + 1);
+
+        if (sample_rate_hz != rate_hz)
+            fprintf(stderr, "MPU9250: %u Hz is not available, sampling at %.1f Hz\n", rate_hz, sample_rate_hz);
+    }
+
+    // The I2C master delay counts samples, keep the magnetometer polling rate unchanged
+    set_mag_read_rate();
+    return sample_rate_hz;
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    LOW PASS FILTER
+usage: selects the widest gyroscope and accelerometer DLPF bandwidth that is not above
+bandwidth_hz. Suitable bandwidths are 184, 92, 41, 20, 10 and 5 Hz. The filter applies to sample
+rates up to 1000 Hz, higher rates bypass it.
+returns the gyroscope bandwidth set in Hz
+-----------------------------------------------------------------------------------------------*/
+
+unsigned int MPU9250::set_lowpass(unsigned int bandwidth_hz)
+{
+    // Gyroscope bandwidth of BITS_DLPF_CFG_188HZ to BITS_DLPF_CFG_5HZ
+    static const unsigned int bandwidth[] = {184, 92, 41, 20, 10, 5};
+    unsigned int i;
+
+    for (i = 0; i < sizeof(bandwidth) / sizeof(bandwidth[0]) - 1; i++) {
+        if (bandwidth[i] <= bandwidth_hz)
+            break;
     }
-    _mx = bit_data[0] * magnetometer_ASA[0];
-    _my = bit_data[1] * magnetometer_ASA[1];
-    _mz = bit_data[2] * magnetometer_ASA[2];
+    dlpf_cfg = BITS_DLPF_CFG_188HZ + i;
+
+    // The accelerometer DLPF uses the same configuration values
+    WriteReg(MPUREG_ACCEL_CONFIG_2, dlpf_cfg);
+    if (sample_rate_hz <= 1000)
+        WriteReg(MPUREG_CONFIG, BIT_FIFO_MODE_STOP | dlpf_cfg);
+
+    return bandwidth[i];
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    FULL SCALE RANGE
+usage: select the smallest accelerometer (2, 4, 8 or 16 g) or gyroscope (250, 500, 1000 or
+2000 dps) range that covers the requested range
+returns the range set
+-----------------------------------------------------------------------------------------------*/
+
+unsigned int MPU9250::set_accel_range(unsigned int range_g)
+{
+    if (range_g <= 2)
+        return set_acc_scale(BITS_FS_2G);
+    else if (range_g <= 4)
+        return set_acc_scale(BITS_FS_4G);
+    else if (range_g <= 8)
+        return set_acc_scale(BITS_FS_8G);
+    else
+        return set_acc_scale(BITS_FS_16G);
+}
+
+unsigned int MPU9250::set_gyro_range(unsigned int range_dps)
+{
+    if (range_dps <= 250)
+        return set_gyro_scale(BITS_FS_250DPS);
+    else if (range_dps <= 500)
+        return set_gyro_scale(BITS_FS_500DPS);
+    else if (range_dps <= 1000)
+        return set_gyro_scale(BITS_FS_1000DPS);
+    else
+        return set_gyro_scale(BITS_FS_2000DPS);
+}
+
+//-----------------------------------------------------------------------------------------------
+
+void MPU9250::reset_fifo()
+{
+    WriteReg(MPUREG_USER_CTRL, BIT_I2C_MST_EN | BIT_FIFO_RST);
+    usleep(100);
+    WriteReg(MPUREG_USER_CTRL, BIT_I2C_MST_EN | BIT_FIFO_EN);
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    FIFO DRAIN
+usage: call this function periodically in FIFO mode. All complete frames queued since the last
+call are read in one burst and stored in samples, oldest first, with timestamps spread back from
+the read time at the FIFO rate. Magnetometer values are the latest available for the whole batch,
+a new reading is flagged on the last sample only. Frames beyond max_samples stay queued for the
+next call and count in the timestamps. After a FIFO overflow the FIFO is reset and no sample is
+returned.
+Without FIFO mode a single frame is read from the data registers.
+returns the number of samples stored
+-----------------------------------------------------------------------------------------------*/
+
+int MPU9250::update_raw_batch(InertialRawSample *samples, int max_samples)
+{
+    uint8_t response[14 + MPU9250_MAG_BYTES];
+    uint8_t int_status = 0;
+    uint8_t fifo_count[2] = {0};
+    int16_t registers[INERTIAL_RAW_CHANNELS];
+
+    if (max_samples < 1)
+        return 0;
+
+    SPItransaction transaction(spi);
+    transaction.read(MPUREG_ACCEL_XOUT_H | READ_FLAG, response, sizeof(response));
+    if (fifo_enabled) {
+        transaction.read(MPUREG_INT_STATUS | READ_FLAG, &int_status, 1);
+        transaction.read(MPUREG_FIFO_COUNTH | READ_FLAG, fifo_count, 2);
+    }
+
+    if (transaction.submit() < 0)
+        return 0;
+
+    uint64_t now = get_timestamp_us();
+    _mag_new = decode_raw(response, registers);
+    if (_mag_new)
+        _mag_timestamp = now;
+
+    if (!fifo_enabled) {
+        memcpy(samples[0].data, registers, sizeof(registers));
+        samples[0].timestamp = take_sample_timestamp();
+        samples[0].mag_new = _mag_new;
+        return 1;
+    }
+
+    // Frames are lost once the FIFO fills up and the rest is no longer frame aligned,
+    // drop it all and start over from an empty one
+    if (int_status & BIT_FIFO_OFLOW_INT) {
+        reset_fifo();
+        return 0;
+    }
+
+    // A glitched count must not overrun fifo_tx/fifo_rx
+    unsigned int count = ((fifo_count[0] & 0x1F) << 8) | fifo_count[1];
+    if (count > MPU_FIFO_SIZE)
+        count = MPU_FIFO_SIZE;
+    int queued = count / fifo_frame_size;
+    int frames = queued;
+    if (frames > max_samples)
+        frames = max_samples;
+    if (frames > MPU_FIFO_SIZE / fifo_frame_size)
+        frames = MPU_FIFO_SIZE / fifo_frame_size;
+    // Frames left in the FIFO are newer than the ones read now
+    int remaining = queued - frames;
+
+    if (frames > 0 && spi.transfer(fifo_tx, fifo_rx, frames * fifo_frame_size + 1, spi.getBurstSpeed()) < 0)
+        frames = 0;
+
+    for (int n = 0; n < frames; n++) {
+        const uint8_t *frame = &fifo_rx[1 + n * fifo_frame_size];
+        const uint8_t *gyro = frame;
+        int16_t *data = samples[n].data;
+        int i;
+
+        // Channels missing from the FIFO frame come from the data registers
+        memcpy(data, registers, sizeof(registers));
+
+        if (fifo_frame_size == 14) {
+            for(i=0; i<3; i++) {
+                data[i] = ((int16_t)frame[i*2] << 8) | frame[i*2+1];
+            }
+            data[INERTIAL_RAW_TEMP] = ((int16_t)frame[6] << 8) | frame[7];
+            gyro = &frame[8];
+        }
+
+        for(i=0; i<3; i++) {
+            data[i+3] = ((int16_t)gyro[i*2] << 8) | gyro[i*2+1];
+        }
+
+        samples[n].timestamp = now - (uint64_t)((frames - 1 - n + remaining) * fifo_period_us);
+        // A new magnetometer reading is reported once, with the latest frame
+        samples[n].mag_new = _mag_new && n == frames - 1;
+    }
+
+    return frames;
+}
+
+//-----------------------------------------------------------------------------------------------
+
+int MPU9250::update_batch(InertialSample *samples, int max_samples)
+{
+    InertialRawSample raw[MPU_FIFO_SIZE / 6];
+
+    if (max_samples > MPU_FIFO_SIZE / 6)
+        max_samples = MPU_FIFO_SIZE / 6;
+
+    int frames = update_raw_batch(raw, max_samples);
+
+    for (int n = 0; n < frames; n++) {
+        apply_raw(raw[n].data);
+        read_sample(&samples[n]);
+        samples[n].timestamp = raw[n].timestamp;
+    }
+
+    return frames;
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    DATA READY
+usage: call this function after initialize() to raise the INT pin, wired to gpio pin, whenever a
+new sample is available at rate_hz. The interrupt is latched until the sample registers are
+read, so wait_data_ready() followed by update() reads every sample exactly once.
+returns true if the gpio edge could be set up
+-----------------------------------------------------------------------------------------------*/
+
+bool MPU9250::enable_data_ready(uint8_t pin, unsigned int rate_hz)
+{
+    if (rate_hz == 0)
+        return false;
+
+    set_sample_rate(rate_hz);
+    WriteReg(MPUREG_INT_PIN_CFG, BIT_LATCH_INT_EN | BIT_INT_ANYRD_2CLEAR);
+    WriteReg(MPUREG_INT_ENABLE, BIT_RAW_RDY_EN);
+
+    return attach_data_ready(pin);
 }
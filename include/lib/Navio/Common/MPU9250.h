@@ -9,6 +9,14 @@ Adapted for Raspberry Pi by Mikhail Avkhimenia (mikhail.avkhimenia@emlid.com)
 #include "SPIdev.h"
 #include "InertialSensor.h"
 
+#define MPU_FIFO_SIZE 512
+
+#define MPU9250_SPI_SLOW_HZ  1000000    // all registers, max 1 MHz
+#define MPU9250_SPI_FAST_HZ  20000000   // sensor and interrupt registers only
+
+#define MPU9250_MAG_READ_HZ  200        // AK8963 polling rate, twice its 100 Hz output rate
+#define MPU9250_MAG_BYTES    8          // ST1, HXL..HZH, ST2
+
 class MPU9250 : public InertialSensor
 {
 public:
@@ -18,11 +26,28 @@ public:
     bool probe();
     void update();
 
+    bool enable_fifo(unsigned int rate_hz);
+    int update_batch(InertialSample *samples, int max_samples);
+    int update_raw_batch(InertialRawSample *samples, int max_samples);
+    void get_raw_scale(float scale[INERTIAL_RAW_TEMP]);
+    bool enable_data_ready(uint8_t pin, unsigned int rate_hz);
+
+    float set_sample_rate(unsigned int rate_hz);
+    unsigned int set_lowpass(unsigned int bandwidth_hz);
+    unsigned int set_accel_range(unsigned int range_g);
+    unsigned int set_gyro_range(unsigned int range_dps);
+
 private:
     unsigned int WriteReg(uint8_t WriteAddr, uint8_t WriteData);
     unsigned int ReadReg(uint8_t ReadAddr);
     void ReadRegs(uint8_t ReadAddr, uint8_t *ReadBuf, unsigned int Bytes);
 
+    bool decode_raw(const uint8_t *response, int16_t *data);
+    void apply_raw(const int16_t *data);
+    void reset_fifo();
+    void start_mag_autoread();
+    void set_mag_read_rate();
+
     unsigned int set_gyro_scale(int scale);
     unsigned int set_acc_scale(int scale);
 
@@ -34,6 +59,18 @@ private:
 
     int calib_data[3];
     float magnetometer_ASA[3];
+
+    SPIdev spi;
+
+    float sample_rate_hz;
+    uint8_t dlpf_cfg;
+    uint8_t mag_last[MPU9250_MAG_BYTES];
+
+    bool fifo_enabled;
+    unsigned int fifo_frame_size;
+    float fifo_period_us;
+    unsigned char fifo_tx[MPU_FIFO_SIZE + 1];
+    unsigned char fifo_rx[MPU_FIFO_SIZE + 1];
 };
 
 #endif //_MPU9250_H
@@ -91,6 +128,7 @@ private:
 #define MPUREG_I2C_MST_STATUS      0x36
 #define MPUREG_INT_PIN_CFG         0x37
 #define MPUREG_INT_ENABLE          0x38
+#define MPUREG_INT_STATUS          0x3A
 #define MPUREG_ACCEL_XOUT_H        0x3B
 #define MPUREG_ACCEL_XOUT_L        0x3C
 #define MPUREG_ACCEL_YOUT_H        0x3D
@@ -210,9 +248,26 @@ private:
 #define BITS_DLPF_CFG_5HZ           0x06
 #define BITS_DLPF_CFG_2100HZ_NOLPF  0x07
 #define BITS_DLPF_CFG_MASK          0x07
+#define BIT_LATCH_INT_EN            0x20
 #define BIT_INT_ANYRD_2CLEAR        0x10
 #define BIT_RAW_RDY_EN              0x01
 #define BIT_I2C_IF_DIS              0x10
+#define BIT_FIFO_MODE_STOP          0x40
+#define BIT_FIFO_EN                 0x40
+#define BIT_I2C_MST_EN              0x20
+#define BIT_FIFO_RST                0x04
+#define BIT_FIFO_OFLOW_INT          0x10
+#define BITS_FIFO_TEMP              0x80
+#define BITS_FIFO_GYRO              0x70
+#define BITS_FIFO_ACCEL             0x08
+#define BIT_SLV0_DLY_EN             0x01
+#define BITS_I2C_MST_DLY_MASK       0x1F
+#define BIT_I2C_SLV_EN              0x80
+
+// Configuration bits AK8963
+#define AK8963_ST1_DRDY             0x01
+#define AK8963_CNTL1_16BIT_8HZ      0x12
+#define AK8963_CNTL1_16BIT_100HZ    0x16
 
 #define READ_FLAG                   0x80
 
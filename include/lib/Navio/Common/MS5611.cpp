@@ -26,6 +26,8 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <time.h>
+#include <string.h>
 #include "MS5611.h"
 
 /** MS5611 constructor.
@@ -34,6 +36,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 MS5611::MS5611(uint8_t address) {
     this->devAddr = address;
+    D1 = 0;
+    D2 = 0;
+    TEMP = 0;
+    PRES = 0;
+    ALT = 0;
+    state = STATE_IDLE;
+    temperature_ratio = MS5611_TEMPERATURE_RATIO;
+    pressure_count = 0;
+    has_temperature = false;
+    sea_level_pressure = MS5611_SEA_LEVEL_PRESSURE;
+    sample_seq = 0;
+    memset(&sample, 0, sizeof(sample));
+    setOversampling(4096);
+}
+
+/** Wait for a conversion queued by tick(), its completion refers to this object.
+ */
+MS5611::~MS5611() {
+    while (state != STATE_IDLE && !adc.ready())
+        usleep(1000);
 }
 
 /** Power on and prepare for general usage.
@@ -107,38 +129,87 @@ void MS5611::readTemperature() {
  *  More info about these calculations is available in the datasheet.
  */
 void MS5611::calculatePressureAndTemperature() {
-    float dT = D2 - C5 * pow(2, 8);
-    TEMP = (2000 + ((dT * C6) / pow(2, 23)));
-    float OFF = C2 * pow(2, 16) + (C4 * dT) / pow(2, 7);
-    float SENS = C1 * pow(2, 15) + (C3 * dT) / pow(2, 8);
-
-    float T2, OFF2, SENS2;
-
-    if (TEMP >= 2000)
-    {
-        T2 = 0;
-        OFF2 = 0;
-        SENS2 = 0;
-    }
-    if (TEMP < 2000)
-    {
-        T2 = dT * dT / pow(2, 31);
-        OFF2 = 5 * pow(TEMP - 2000, 2) / 2;
-        SENS2 = OFF2 / 2;
-    }
-    if (TEMP < -1500)
-    {
-        OFF2 = OFF2 + 7 * pow(TEMP + 1500, 2);
-        SENS2 = SENS2 + 11 * pow(TEMP + 1500, 2) / 2;
+    const uint16_t prom[6] = {C1, C2, C3, C4, C5, C6};
+    int32_t temperature, pressure;
+
+    compensate(prom, D1, D2, &temperature, &pressure);
+
+    PRES = pressure / 100.0f;
+    TEMP = temperature / 100.0f;
+}
+
+/** Calculate the compensated temperature alone, before the first pressure reading
+ */
+void MS5611::calculateTemperature() {
+    const uint16_t prom[6] = {C1, C2, C3, C4, C5, C6};
+    int32_t temperature, pressure;
+
+    compensate(prom, 0, D2, &temperature, &pressure);
+
+    TEMP = temperature / 100.0f;
+}
+
+/** Datasheet compensation in 64-bit integer arithmetic, including the second
+ *  order temperature compensation. Exact for the full 24-bit D1/D2 range.
+ * @param prom calibration data C1 to C6
+ * @param d1 raw pressure, d2 raw temperature
+ * @param temperature in 0.01 degrees of Celsius
+ * @param pressure in 0.01 millibars
+ */
+void MS5611::compensate(const uint16_t prom[6], uint32_t d1, uint32_t d2,
+                        int32_t *temperature, int32_t *pressure) {
+    int64_t dT = (int64_t)d2 - ((int64_t)prom[4] << 8);
+    int64_t temp = 2000 + ((dT * prom[5]) >> 23);
+    int64_t off = ((int64_t)prom[1] << 16) + ((prom[3] * dT) >> 7);
+    int64_t sens = ((int64_t)prom[0] << 15) + ((prom[2] * dT) >> 8);
+
+    if (temp < 2000) {
+        int64_t t2 = (dT * dT) >> 31;
+        int64_t low = (temp - 2000) * (temp - 2000);
+        int64_t off2 = (5 * low) >> 1;
+        int64_t sens2 = (5 * low) >> 2;
+
+        if (temp < -1500) {
+            int64_t very_low = (temp + 1500) * (temp + 1500);
+            off2 += 7 * very_low;
+            sens2 += (11 * very_low) >> 1;
+        }
+
+        temp -= t2;
+        off -= off2;
+        sens -= sens2;
     }
 
-    TEMP = TEMP - T2;
-    OFF = OFF - OFF2;
-    SENS = SENS - SENS2;
+    *temperature = (int32_t)temp;
+    *pressure = (int32_t)((((d1 * sens) >> 21) - off) >> 15);
+}
+
+/** Barometric formula without pow(): linear interpolation in a table of the
+ *  pressure ratio, error below 0.02 m near sea level and 0.2 m at 1/4 of it.
+ *  Ratios outside the table fall back to the exact formula.
+ * @param pressure and sea_level_pressure in the same unit
+ * @return Altitude in meters
+ */
+float MS5611::pressureToAltitude(float pressure, float sea_level_pressure) {
+    static const int size = 256;
+    static const float low = 0.25f, high = 1.25f;
+    struct Table {
+        float altitude[size + 1];
+        Table() {
+            for (int i = 0; i <= size; i++)
+                altitude[i] = 44330.0 * (1.0 - pow(low + (high - low) * i / size, 0.190295));
+        }
+    };
+    static const Table table;
+
+    float ratio = pressure / sea_level_pressure;
+    if (!(ratio >= low && ratio < high))
+        return 44330.0 * (1.0 - pow(ratio, 0.190295));
 
-    // Final calculations
-    PRES = ((D1 * SENS) / pow(2, 21) - OFF) / pow(2, 15) / 100;
-    TEMP = TEMP / 100;
+    float x = (ratio - low) * (size / (high - low));
+    int i = (int)x;
+    float f = x - i;
+    return table.altitude[i] + f * (table.altitude[i + 1] - table.altitude[i]);
 }
 
 /** Perform pressure and temperature reading and calculation at once.
@@ -156,6 +227,155 @@ void MS5611::update() {
     calculatePressureAndTemperature();
 }
 
+/** Select the oversampling ratio used by tick().
+ * @param osr 256, 512, 1024, 2048 or 4096, other values select the next lower one
+ */
+void MS5611::setOversampling(uint16_t osr) {
+    // Maximum conversion times from the datasheet
+    if (osr >= 4096) {
+        d1_cmd = MS5611_RA_D1_OSR_4096; d2_cmd = MS5611_RA_D2_OSR_4096; conversion_us = 9040;
+    } else if (osr >= 2048) {
+        d1_cmd = MS5611_RA_D1_OSR_2048; d2_cmd = MS5611_RA_D2_OSR_2048; conversion_us = 4540;
+    } else if (osr >= 1024) {
+        d1_cmd = MS5611_RA_D1_OSR_1024; d2_cmd = MS5611_RA_D2_OSR_1024; conversion_us = 2280;
+    } else if (osr >= 512) {
+        d1_cmd = MS5611_RA_D1_OSR_512; d2_cmd = MS5611_RA_D2_OSR_512; conversion_us = 1170;
+    } else {
+        d1_cmd = MS5611_RA_D1_OSR_256; d2_cmd = MS5611_RA_D2_OSR_256; conversion_us = 600;
+    }
+}
+
+/** Set how many pressure conversions tick() runs per temperature conversion.
+ *  Temperature changes slowly, refreshing it less often raises the pressure rate.
+ */
+void MS5611::setTemperatureRatio(unsigned int ratio) {
+    temperature_ratio = ratio > 0 ? ratio : 1;
+}
+
+/** Set the reference pressure for getAltitude()
+ * @param pressure in millibars
+ */
+void MS5611::setSeaLevelPressure(float pressure) {
+    sea_level_pressure = pressure;
+}
+
+/** Advance the conversion cycle without blocking, call it every cycle of a periodic loop.
+ *  A finished conversion is taken and the next one started, pressure and temperature
+ *  conversions alternate at the temperature ratio. The transfers run on the shared I2C
+ *  scheduler, the caller never waits for the bus. Calls before the result of the
+ *  conversion has been read return immediately.
+ * @return True if a new pressure value was published
+ */
+bool MS5611::tick() {
+    uint64_t now = getTimeUs();
+    bool published = false;
+
+    if (state != STATE_IDLE) {
+        if (!adc.ready())
+            return false;
+
+        // A failed transfer reads as zero and is skipped like a cut short conversion
+        uint32_t value = 0;
+        if (adc.status > 0)
+            value = (adc.data[0] << 16) | (adc.data[1] << 8) | adc.data[2];
+
+        if (state == STATE_PRESSURE) {
+            D1 = value;
+            // A zero result means the conversion was cut short, skip it
+            if (D1 != 0 && has_temperature) {
+                calculatePressureAndTemperature();
+                publish(now, 0);
+                published = true;
+            }
+        } else {
+            D2 = value;
+            if (D2 != 0) {
+                has_temperature = true;
+                // The pressure needs a D1 reading too, the temperature only D2
+                if (D1 != 0)
+                    calculatePressureAndTemperature();
+                else
+                    calculateTemperature();
+                publish(0, now);
+            }
+        }
+    }
+
+    bool temperature = !has_temperature || pressure_count >= temperature_ratio;
+    adc.reset();
+    if (!I2Cscheduler::get().write(I2C_PRIORITY_NORMAL, devAddr, temperature ? d2_cmd : d1_cmd,
+                                   NULL, 0, conversionStarted, this)) {
+        // Try again on the next call
+        state = STATE_IDLE;
+        return published;
+    }
+
+    if (temperature) {
+        state = STATE_TEMPERATURE;
+        pressure_count = 0;
+    } else {
+        state = STATE_PRESSURE;
+        pressure_count++;
+    }
+
+    return published;
+}
+
+/** Scheduler callback of the conversion command. The ADC read is held back
+ *  for the conversion time from the moment the command was on the bus.
+ */
+void MS5611::conversionStarted(void *arg, int status, const uint8_t *data, unsigned int length) {
+    MS5611 *baro = (MS5611 *)arg;
+    uint64_t ready_us = I2Cscheduler::get_time_us() + baro->conversion_us;
+
+    if (status < 0 ||
+        !I2Cscheduler::get().read(I2C_PRIORITY_NORMAL, baro->devAddr, MS5611_RA_ADC, 3,
+                                  I2Cresult::complete, &baro->adc, ready_us))
+        I2Cresult::complete(&baro->adc, -1, NULL, 0);
+}
+
+uint64_t MS5611::getTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Store the latest results for getSample(), a zero timestamp keeps the previous one.
+ *  The sequence counter is odd while the sample is being written.
+ */
+void MS5611::publish(uint64_t pressure_timestamp, uint64_t temperature_timestamp) {
+    if (pressure_timestamp != 0)
+        ALT = pressureToAltitude(PRES, sea_level_pressure);
+
+    sample_seq++;
+    __sync_synchronize();
+    if (pressure_timestamp != 0) {
+        sample.pressure = PRES;
+        sample.temperature = TEMP;
+        sample.altitude = ALT;
+        sample.pressure_timestamp = pressure_timestamp;
+    }
+    if (temperature_timestamp != 0) {
+        sample.temperature = TEMP;
+        sample.temperature_timestamp = temperature_timestamp;
+    }
+    __sync_synchronize();
+    sample_seq++;
+}
+
+/** Get the latest pressure, temperature and altitude with their timestamps.
+ *  Safe to call from another thread than tick(), never blocks the writer.
+ */
+void MS5611::getSample(MS5611Sample *result) {
+    unsigned int seq;
+    do {
+        seq = sample_seq;
+        __sync_synchronize();
+        *result = sample;
+        __sync_synchronize();
+    } while ((seq & 1) || seq != sample_seq);
+}
+
 /** Get calculated temperature value
  @return Temperature in degrees of Celsius
  */
@@ -169,3 +389,10 @@ float MS5611::getTemperature() {
 float MS5611::getPressure() {
 	return PRES;
 }
+
+/** Get altitude from the last tick() pressure
+ @return Altitude in meters above the sea level pressure
+ */
+float MS5611::getAltitude() {
+	return ALT;
+}
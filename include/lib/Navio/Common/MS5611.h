@@ -30,8 +30,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MS5611_HPP
 
 #include "I2Cdev.h"
+#include "I2Cscheduler.h"
 #include <math.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <string>
 
 #define MS5611_ADDRESS_CSB_LOW  0x76
@@ -62,9 +64,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MS5611_RA_D2_OSR_2048   0x56
 #define MS5611_RA_D2_OSR_4096   0x58
 
+#define MS5611_SEA_LEVEL_PRESSURE   1013.25     // mbar
+#define MS5611_TEMPERATURE_RATIO    5           // pressure conversions per temperature conversion
+
+struct MS5611Sample {
+    float pressure;                 // mbar
+    float temperature;              // degrees of Celsius
+    float altitude;                 // m above the reference pressure
+    uint64_t pressure_timestamp;    // us, CLOCK_MONOTONIC
+    uint64_t temperature_timestamp;
+};
+
 class MS5611 {
     public:
 	    MS5611(uint8_t address = MS5611_DEFAULT_ADDRESS);
+	    ~MS5611();
 
         void initialize();
         bool testConnection();
@@ -78,15 +92,52 @@ class MS5611 {
 	    void calculatePressureAndTemperature();
 	    void update();
 
+	    static void compensate(const uint16_t prom[6], uint32_t d1, uint32_t d2,
+	                           int32_t *temperature, int32_t *pressure);
+	    static float pressureToAltitude(float pressure, float sea_level_pressure);
+
+	    void setOversampling(uint16_t osr);
+	    void setTemperatureRatio(unsigned int ratio);
+	    void setSeaLevelPressure(float pressure);
+	    bool tick();
+
 	    float getTemperature();
 	    float getPressure();
+	    float getAltitude();
+	    void getSample(MS5611Sample *sample);
 
     private:
+	    enum State {
+	        STATE_IDLE,
+	        STATE_PRESSURE,
+	        STATE_TEMPERATURE
+	    };
+
+	    static uint64_t getTimeUs();
+	    static void conversionStarted(void *arg, int status, const uint8_t *data, unsigned int length);
+	    void calculateTemperature();
+	    void publish(uint64_t pressure_timestamp, uint64_t temperature_timestamp);
+
 	    uint8_t devAddr; // I2C device adress
 	    uint16_t C1, C2, C3, C4, C5, C6; // Calibration data
 	    uint32_t D1, D2; // Raw measurement data
 	    float TEMP; // Calculated temperature
 	    float PRES; // Calculated pressure
+	    float ALT; // Calculated altitude
+
+	    // Non-blocking conversion cycle
+	    State state;
+	    uint8_t d1_cmd, d2_cmd; // conversion commands for the selected OSR
+	    unsigned int conversion_us;
+	    unsigned int temperature_ratio;
+	    unsigned int pressure_count;
+	    bool has_temperature;
+	    I2Cresult adc; // result of the conversion queued on the I2C scheduler
+	    float sea_level_pressure;
+
+	    // Latest results, guarded by a sequence counter
+	    volatile unsigned int sample_seq;
+	    MS5611Sample sample;
 };
 
 #endif // MS5611_HPP
@@ -8,6 +8,13 @@ public:
     virtual bool enable(int channel) = 0;
     virtual bool set_frequency(int channel, float frequency) = 0;
     virtual bool set_duty_cycle(int channel, float period) = 0;
+
+    // Several channels updated together: values staged here take effect at
+    // commit(). Backends without batching apply each value right away.
+    virtual bool stage_duty_cycle(int channel, float period) { return set_duty_cycle(channel, period); }
+    virtual bool commit() { return true; }
+    // Time between the first and the last update of the last commit, -1 if not measured
+    virtual int get_commit_skew_us() { return -1; }
 };
 
 #endif // RCOUTPUT
@@ -41,13 +41,124 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <stdint.h>
+#include <string>
 
 class SPIdev {
 public:
-    SPIdev()
+    SPIdev() :
+        spi_fd(-1),
+        speed_hz(1000000),
+        burst_speed_hz(1000000),
+        bits_per_word(8),
+        mode(SPI_MODE_0)
     {
     }
 
+    /* A long-lived handle bound to one chip-select. The device is opened
+       lazily on the first transfer and stays open until close() or the
+       handle is destroyed, so periodic readers pay one ioctl per transfer
+       instead of open/ioctl/close. speed_hz is the clock used for
+       configuration accesses, burst_speed_hz the clock used for data
+       bursts (defaults to speed_hz). */
+    SPIdev(const char *spidev,
+           unsigned int speed_hz = 1000000,
+           unsigned int burst_speed_hz = 0,
+           unsigned char bits_per_word = 8,
+           unsigned char mode = SPI_MODE_0) :
+        device(spidev),
+        spi_fd(-1),
+        speed_hz(speed_hz),
+        burst_speed_hz(burst_speed_hz ? burst_speed_hz : speed_hz),
+        bits_per_word(bits_per_word),
+        mode(mode)
+    {
+    }
+
+    ~SPIdev()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        if (spi_fd >= 0)
+            return true;
+
+        spi_fd = ::open(device.c_str(), O_RDWR);
+
+        if (spi_fd < 0) {
+            printf("Error: Can not open SPI device %s\n", device.c_str());
+            return false;
+        }
+
+        // Bus settings are applied once here and cached in the handle,
+        // each transfer then selects its own clock up to the fastest one
+        unsigned int max_speed_hz = speed_hz > burst_speed_hz ? speed_hz : burst_speed_hz;
+        if (ioctl(spi_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+            ioctl(spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits_per_word) < 0 ||
+            ioctl(spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &max_speed_hz) < 0) {
+            printf("Error: Can not configure SPI device %s\n", device.c_str());
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close()
+    {
+        if (spi_fd >= 0) {
+            ::close(spi_fd);
+            spi_fd = -1;
+        }
+    }
+
+    bool isOpen() const { return spi_fd >= 0; }
+    const char *getDevice() const { return device.c_str(); }
+    unsigned int getSpeed() const { return speed_hz; }
+    unsigned int getBurstSpeed() const { return burst_speed_hz; }
+    void setBurstSpeed(unsigned int hz)
+    {
+        burst_speed_hz = hz;
+        close();    // re-applied on the next transfer
+    }
+    unsigned char getBitsPerWord() const { return bits_per_word; }
+
+    // speed_hz of 0 selects the configuration clock
+    int transfer(unsigned char *tx,
+                 unsigned char *rx,
+                 unsigned int length,
+                 unsigned int speed_hz = 0)
+    {
+        if (!open())
+            return -1;
+
+        spi_ioc_transfer spi_transfer;
+
+        memset(&spi_transfer, 0, sizeof(spi_ioc_transfer));
+
+        spi_transfer.tx_buf = (unsigned long)tx;
+        spi_transfer.rx_buf = (unsigned long)rx;
+        spi_transfer.len = length;
+        spi_transfer.speed_hz = speed_hz ? speed_hz : this->speed_hz;
+        spi_transfer.bits_per_word = bits_per_word;
+
+        return ioctl(spi_fd, SPI_IOC_MESSAGE(1), &spi_transfer);
+    }
+
+    // Submits count prepared transfers as a single SPI message
+    int transfer(spi_ioc_transfer *transfers, unsigned int count)
+    {
+        if (!open())
+            return -1;
+
+        return ioctl(spi_fd, SPI_IOC_MESSAGE(count), transfers);
+    }
+
+    /* One-shot transfer that opens and closes the device every call.
+       Kept for callers that do not own a handle; prefer the member
+       transfer() in periodic loops. */
 	static int transfer(const char *spidev,
                         unsigned char *tx,
                         unsigned char *rx,
@@ -94,6 +205,120 @@ public:
 
         return status;
 	}
+
+private:
+    SPIdev(const SPIdev&);
+    SPIdev& operator=(const SPIdev&);
+
+    std::string device;
+    int spi_fd;
+    unsigned int speed_hz;
+    unsigned int burst_speed_hz;
+    unsigned char bits_per_word;
+    unsigned char mode;
+};
+
+/* Queues several register accesses on one device and submits them with a
+   single SPI_IOC_MESSAGE(n) ioctl. Chip-select is released between the
+   queued accesses, so the sensor sees each one as its own register
+   transaction. Writes are clocked at the device configuration speed and
+   reads at its burst speed. Read results are copied to the caller buffers
+   on submit(). */
+class SPItransaction {
+public:
+    static const unsigned int MAX_TRANSFERS = 72;
+    static const unsigned int BUFFER_SIZE = 512;
+
+    SPItransaction(SPIdev &dev) : dev(dev)
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        count = 0;
+        used = 0;
+    }
+
+    bool write(uint8_t addr, uint8_t data)
+    {
+        if (!add(2, NULL, dev.getSpeed()))
+            return false;
+
+        tx[offset[count - 1]] = addr;
+        tx[offset[count - 1] + 1] = data;
+        return true;
+    }
+
+    // addr is sent as is, the caller sets the read/auto-increment flags
+    bool read(uint8_t addr, uint8_t *buf, unsigned int bytes)
+    {
+        if (!add(bytes + 1, buf, dev.getBurstSpeed()))
+            return false;
+
+        tx[offset[count - 1]] = addr;
+        return true;
+    }
+
+    int submit()
+    {
+        if (count == 0)
+            return 0;
+
+        for (unsigned int i = 0; i < count; i++) {
+            memset(&transfers[i], 0, sizeof(spi_ioc_transfer));
+            transfers[i].tx_buf = (unsigned long)&tx[offset[i]];
+            transfers[i].rx_buf = (unsigned long)&rx[offset[i]];
+            transfers[i].len = length[i];
+            transfers[i].speed_hz = speed[i];
+            transfers[i].bits_per_word = dev.getBitsPerWord();
+            transfers[i].cs_change = (i + 1 < count);
+        }
+
+        int status = dev.transfer(transfers, count);
+
+        if (status >= 0) {
+            for (unsigned int i = 0; i < count; i++) {
+                if (dest[i] != NULL)
+                    memcpy(dest[i], &rx[offset[i] + 1], length[i] - 1);
+            }
+        }
+
+        clear();
+        return status;
+    }
+
+private:
+    SPItransaction(const SPItransaction&);
+    SPItransaction& operator=(const SPItransaction&);
+
+    bool add(unsigned int len, uint8_t *buf, unsigned int speed_hz)
+    {
+        if (count >= MAX_TRANSFERS || used + len > BUFFER_SIZE) {
+            printf("Error: SPI transaction is full\n");
+            return false;
+        }
+
+        memset(&tx[used], 0, len);
+        offset[count] = used;
+        length[count] = len;
+        dest[count] = buf;
+        speed[count] = speed_hz;
+        used += len;
+        count++;
+        return true;
+    }
+
+    SPIdev &dev;
+    spi_ioc_transfer transfers[MAX_TRANSFERS];
+    unsigned int offset[MAX_TRANSFERS];
+    unsigned int length[MAX_TRANSFERS];
+    unsigned int speed[MAX_TRANSFERS];
+    uint8_t *dest[MAX_TRANSFERS];
+    unsigned char tx[BUFFER_SIZE];
+    unsigned char rx[BUFFER_SIZE];
+    unsigned int count;
+    unsigned int used;
 };
 
 #endif //_SPIDEV_H_
@@ -0,0 +1,179 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "SysfsAttr.h"
+
+SysfsAttr::SysfsAttr() :
+    _fd(-1),
+    _error(0)
+{
+}
+
+SysfsAttr::~SysfsAttr()
+{
+    close();
+}
+
+int SysfsAttr::fail(int error)
+{
+    _error = error;
+    return error;
+}
+
+int SysfsAttr::open(const char *path, int flags)
+{
+    close();
+
+    _fd = ::open(path, flags | O_CLOEXEC);
+    if (_fd < 0) {
+        return fail(-errno);
+    }
+    _error = 0;
+    return 0;
+}
+
+void SysfsAttr::close()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+int SysfsAttr::read(char *buffer, size_t size)
+{
+    if (_fd < 0) {
+        return fail(-EBADF);
+    }
+
+    ssize_t ret = ::pread(_fd, buffer, size, 0);
+    if (ret < 0) {
+        return fail(-errno);
+    }
+    return ret;
+}
+
+int SysfsAttr::write(const char *data, size_t length)
+{
+    if (_fd < 0) {
+        return fail(-EBADF);
+    }
+
+    ssize_t ret = ::pwrite(_fd, data, length, 0);
+    if (ret < 0) {
+        return fail(-errno);
+    }
+    // sysfs stores take the whole value or fail
+    if ((size_t)ret != length) {
+        return fail(-EIO);
+    }
+    return ret;
+}
+
+int SysfsAttr::write(const char *text)
+{
+    return write(text, strlen(text));
+}
+
+int SysfsAttr::read_int(long *value, int base)
+{
+    char buffer[32];
+
+    int length = read(buffer, sizeof(buffer));
+    if (length < 0) {
+        return length;
+    }
+    if (parse_int(buffer, length, value, base) == 0) {
+        return fail(-EINVAL);
+    }
+    return 0;
+}
+
+int SysfsAttr::write_uint(unsigned long value)
+{
+    char buffer[24];
+    char *end = buffer + sizeof(buffer);
+    char *text = format_uint(end, value);
+
+    int ret = write(text, end - text);
+    return ret < 0 ? ret : 0;
+}
+
+int SysfsAttr::write_once(const char *path, const char *text)
+{
+    SysfsAttr attr;
+    int ret = attr.open(path, O_WRONLY);
+    if (ret < 0) {
+        return ret;
+    }
+    return attr.write(text);
+}
+
+int SysfsAttr::write_once_uint(const char *path, unsigned long value)
+{
+    SysfsAttr attr;
+    int ret = attr.open(path, O_WRONLY);
+    if (ret < 0) {
+        return ret;
+    }
+    return attr.write_uint(value);
+}
+
+int SysfsAttr::read_once_int(const char *path, long *value, int base)
+{
+    SysfsAttr attr;
+    int ret = attr.open(path, O_RDONLY);
+    if (ret < 0) {
+        return ret;
+    }
+    return attr.read_int(value, base);
+}
+
+size_t SysfsAttr::parse_int(const char *buffer, size_t length, long *value, int base)
+{
+    size_t i = 0;
+    while (i < length && (buffer[i] == ' ' || buffer[i] == '\t' || buffer[i] == '\n')) {
+        i++;
+    }
+
+    bool negative = false;
+    if (i < length && (buffer[i] == '-' || buffer[i] == '+')) {
+        negative = buffer[i] == '-';
+        i++;
+    }
+
+    if (base == 16 && i + 1 < length && buffer[i] == '0' && (buffer[i + 1] | 0x20) == 'x') {
+        i += 2;
+    }
+
+    size_t digits = i;
+    unsigned long result = 0;
+    for (; i < length; i++) {
+        unsigned int digit = (unsigned char)buffer[i] - '0';
+        if (digit > 9) {
+            unsigned int letter = ((unsigned char)buffer[i] | 0x20) - 'a';
+            digit = letter < 6 ? letter + 10 : base;
+        }
+        if (digit >= (unsigned int)base) {
+            break;
+        }
+        result = result * base + digit;
+    }
+
+    if (i == digits) {
+        return 0;
+    }
+    *value = negative ? -(long)result : (long)result;
+    return i;
+}
+
+char *SysfsAttr::format_uint(char *buffer_end, unsigned long value)
+{
+    char *text = buffer_end;
+    do {
+        *--text = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    return text;
+}
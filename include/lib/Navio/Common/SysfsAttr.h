@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <fcntl.h>
+
+/* Handle on one sysfs attribute. The file is opened once and every access
+   is a single pread or pwrite at offset 0, so an open attribute can be
+   used in periodic loops without allocating or reopening it. Values are
+   parsed and formatted without stdio. Errors are not printed, calls return
+   -errno and the last error is kept for the caller to report. */
+class SysfsAttr
+{
+public:
+    SysfsAttr();
+    ~SysfsAttr();
+
+    // path is used only during the call, returns 0 or -errno
+    int open(const char *path, int flags = O_RDONLY);
+    void close();
+    bool is_open() const { return _fd >= 0; }
+    int last_error() const { return _error; }
+
+    // Return the number of bytes transferred or -errno
+    int read(char *buffer, size_t size);
+    int write(const char *data, size_t length);
+    int write(const char *text);
+
+    // Return 0 or -errno, a value without digits is -EINVAL
+    int read_int(long *value, int base = 10);
+    int write_uint(unsigned long value);
+
+    // Open, access and close, for configuration attributes used once
+    static int write_once(const char *path, const char *text);
+    static int write_once_uint(const char *path, unsigned long value);
+    static int read_once_int(const char *path, long *value, int base = 10);
+
+    // Integer with optional whitespace, sign and 0x prefix in base 16,
+    // returns the number of characters used, 0 if there are no digits
+    static size_t parse_int(const char *buffer, size_t length, long *value, int base = 10);
+    // Writes the decimal digits to the end of buffer, returns their start
+    static char *format_uint(char *buffer_end, unsigned long value);
+
+private:
+    SysfsAttr(const SysfsAttr&);
+    SysfsAttr& operator=(const SysfsAttr&);
+
+    int fail(int error);
+
+    int _fd;
+    int _error;
+};
@@ -0,0 +1,129 @@
+/*
+UBX message payloads as sent by the u-blox M8 receivers, see the u-blox 8 /
+u-blox M8 Receiver Description (Protocol Specification) for the fields.
+The structs are packed and little endian like the protocol, so a payload
+in the scanner buffer can be read through a struct pointer without copying.
+*/
+
+#ifndef _UBXMESSAGES_H_
+#define _UBXMESSAGES_H_
+
+#include <stdint.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "UBX payload structs require a little endian host"
+#endif
+
+#define UBX_HEADER_LENGTH   6       // sync chars, class, id, length
+#define UBX_CHECKSUM_LENGTH 2
+
+// class << 8 | id, as returned by UBXParser::decodeMessage()
+#define UBX_ID(cls, id)     (uint16_t)((cls) << 8 | (id))
+
+#pragma pack(push, 1)
+
+struct UBXNavPOSLLH {
+    static const uint16_t ID = UBX_ID(0x01, 0x02);
+
+    uint32_t iTOW;          // ms, GPS time of week
+    int32_t lon;            // deg * 1e-7
+    int32_t lat;            // deg * 1e-7
+    int32_t height;         // mm above ellipsoid
+    int32_t hMSL;           // mm above mean sea level
+    uint32_t hAcc;          // mm
+    uint32_t vAcc;          // mm
+};
+
+struct UBXNavSTATUS {
+    static const uint16_t ID = UBX_ID(0x01, 0x03);
+
+    uint32_t iTOW;          // ms
+    uint8_t gpsFix;         // 0 no fix, 1 dead reckoning, 2 2D, 3 3D, 4 GPS + DR, 5 time only
+    uint8_t flags;          // bit 0 gpsFixOk
+    uint8_t fixStat;
+    uint8_t flags2;
+    uint32_t ttff;          // ms, time to first fix
+    uint32_t msss;          // ms since startup
+};
+
+struct UBXNavPVT {
+    static const uint16_t ID = UBX_ID(0x01, 0x07);
+
+    uint32_t iTOW;          // ms
+    uint16_t year;          // UTC
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;          // bit 0 validDate, bit 1 validTime
+    uint32_t tAcc;          // ns
+    int32_t nano;           // ns, fraction of second
+    uint8_t fixType;        // same values as UBXNavSTATUS::gpsFix
+    uint8_t flags;          // bit 0 gnssFixOK
+    uint8_t flags2;
+    uint8_t numSV;
+    int32_t lon;            // deg * 1e-7
+    int32_t lat;            // deg * 1e-7
+    int32_t height;         // mm above ellipsoid
+    int32_t hMSL;           // mm above mean sea level
+    uint32_t hAcc;          // mm
+    uint32_t vAcc;          // mm
+    int32_t velN;           // mm/s
+    int32_t velE;           // mm/s
+    int32_t velD;           // mm/s
+    int32_t gSpeed;         // mm/s, ground speed
+    int32_t headMot;        // deg * 1e-5, heading of motion
+    uint32_t sAcc;          // mm/s
+    uint32_t headAcc;       // deg * 1e-5
+    uint16_t pDOP;          // * 0.01
+    uint8_t reserved1[6];
+    int32_t headVeh;        // deg * 1e-5
+    int16_t magDec;         // deg * 1e-2
+    uint16_t magAcc;        // deg * 1e-2
+};
+
+struct UBXNavVELNED {
+    static const uint16_t ID = UBX_ID(0x01, 0x12);
+
+    uint32_t iTOW;          // ms
+    int32_t velN;           // cm/s
+    int32_t velE;           // cm/s
+    int32_t velD;           // cm/s
+    uint32_t speed;         // cm/s, 3D
+    uint32_t gSpeed;        // cm/s, ground speed
+    int32_t heading;        // deg * 1e-5
+    uint32_t sAcc;          // cm/s
+    uint32_t cAcc;          // deg * 1e-5
+};
+
+struct UBXTimTP {
+    static const uint16_t ID = UBX_ID(0x0d, 0x01);
+
+    uint32_t towMS;         // ms, time of week of the next time pulse
+    uint32_t towSubMS;      // ms * 2^-32
+    int32_t qErr;           // ps, quantization error of the pulse
+    uint16_t week;
+    uint8_t flags;
+    uint8_t refInfo;
+};
+
+struct UBXCfgMSG {
+    static const uint16_t ID = UBX_ID(0x06, 0x01);
+
+    uint8_t msgClass;
+    uint8_t msgID;
+    uint8_t rate;           // per navigation solution on the current port, 0 disables
+};
+
+struct UBXCfgRATE {
+    static const uint16_t ID = UBX_ID(0x06, 0x08);
+
+    uint16_t measRate;      // ms between measurements
+    uint16_t navRate;       // measurements per navigation solution
+    uint16_t timeRef;       // 0 UTC, 1 GPS time
+};
+
+#pragma pack(pop)
+
+#endif // _UBXMESSAGES_H_
@@ -139,102 +139,105 @@ void UBXParser::updateMessageData(){
     position = scanner->getPosition();
 }
 
-// Function decodeMessage() returns 1 in case of a successful message verification.
-// It looks through the buffer, checks 2 ubx protocol sync chars (0xb5 and 0x62),
-// counts the checksum and if everything is alright, defines the message type by id.
-// In this example we only decode two messages: Nav-Status and Nav-Posllh. It is possible to add more
-// id cases
+// class UBXDispatcher
 
-int UBXParser::decodeMessage(std::vector<double>& data)
+UBXDispatcher::UBXDispatcher() : count(0)
 {
-    int flag=1;
-    int pos;
-    uint16_t id;
-    uint8_t CK_A=0, CK_B=0;
 
-    updateMessageData(); // get the length and end message coordinate from UBX scanner
+}
 
-    pos = position-length; // count the message start position
+bool UBXDispatcher::add(uint16_t id, unsigned int payload_length, Generic handler, Thunk thunk, void* arg)
+{
+    if (count >= max_handlers)
+        return false;
+
+    Entry& entry = entries[count++];
+    entry.id = id;
+    entry.min_length = UBX_HEADER_LENGTH + payload_length + UBX_CHECKSUM_LENGTH;
+    entry.handler = handler;
+    entry.thunk = thunk;
+    entry.arg = arg;
+    return true;
+}
 
-    // All UBX messages start with 2 sync chars: 0xb5 and 0x62
+// Function dispatch() calls the handlers registered for the class/id of a message that
+// already passed checkMessage(). Returns the message id if a handler ran, 0 otherwise.
 
-    if (*(message+pos)!=0xb5) flag=0;
-    if (*(message+pos+1)!=0x62) flag=0;
+int UBXDispatcher::dispatch(const unsigned char* message, unsigned int length)
+{
+    uint16_t id = UBX_ID(message[2], message[3]);
+    int handled = 0;
 
-    // Count the checksum
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[i].id != id || length < entries[i].min_length)
+            continue;
 
-    for (unsigned int i=2;i<(length-2);i++){
-        CK_A += *(message+pos+i);
-        CK_B += CK_A;
+        entries[i].thunk(entries[i].handler, entries[i].arg, message + UBX_HEADER_LENGTH);
+        handled = id;
     }
 
-    if (CK_A != *(message+pos+length-2)) flag=0;
-    if (CK_B != *(message+pos+length-1)) flag=0;
-
-    // If the sync chars, or the checksum is wrong, we should not be doing this anymore
-
-    if (flag==0) return 0;
-
-    // If we got everything right, then it's time to decide, what type of message this is
+    return handled;
+}
 
-    id = (*(message+pos+2)) << 8 | (*(message+pos+3)); // ID is a two-byte number with little endianness
+// Function decodeMessage() returns the message id in case of a successful message verification.
+// It checks the sync chars and the checksum with checkMessage() and then reads the payload in place
+// through the structs from UBXMessages.h.
+// In this example we only decode two messages into the vector: Nav-Status and Nav-Posllh. Other message
+// types are better handled with the typed getPayload() or a UBXDispatcher.
 
-    flag = id; // will return message id, if we got the info decoded
+int UBXParser::decodeMessage(std::vector<double>& data)
+{
+    const unsigned char* start;
+    const UBXNavPOSLLH* posllh;
+    const UBXNavSTATUS* status;
 
-    switch(id){
-        case 258:
-                // ID for Nav-Posllh messages is 0x0102 == 258
-                // In this example we extract 7 variables - longitude, latitude,
-                // height above ellipsoid and mean sea level, horizontal and vertical
-                // accuracy estimate and iTOW - GPS Millisecond Time of Week
+    // If the sync chars, or the checksum is wrong, we should not be doing this anymore
 
-                // All the needed parameters are 4-byte numbers with little endianness.
-                // We know the current message and we want to update the info in the data vector.
-                // First we clear the old data:
+    if (!checkMessage())
+        return 0;
 
-                data.clear();
+    start = message + position - length;
 
-                // Second, we extract the needed data from the message buffer and save it to the vector.
+    if ((posllh = ubx_payload<UBXNavPOSLLH>(start, length)) != NULL)
+    {
+        // iTOW, longitude, latitude, height above ellipsoid and mean sea level,
+        // horizontal and vertical accuracy estimate
+
+        data.clear();
+        data.push_back(posllh->iTOW);
+        data.push_back(posllh->lon);
+        data.push_back(posllh->lat);
+        data.push_back(posllh->height);
+        data.push_back(posllh->hMSL);
+        data.push_back(posllh->hAcc);
+        data.push_back(posllh->vAcc);
+        return UBXNavPOSLLH::ID;
+    }
 
-                //iTOW
-                data.push_back ((unsigned)((*(message+pos+9) << 24) | (*(message+pos+8) << 16) | (*(message+pos+7) << 8) | (*(message+pos+6))));
-                //Longitude
-                data.push_back ((*(message+pos+13) << 24) | (*(message+pos+12) << 16) | (*(message+pos+11) << 8) | (*(message+pos+10)));
-                //Latitude
-                data.push_back ((*(message+pos+17) << 24) | (*(message+pos+16) << 16) | (*(message+pos+15) << 8) | (*(message+pos+14)));
-                //Height above Ellipsoid
-                data.push_back ((*(message+pos+21) << 24) | (*(message+pos+20) << 16) | (*(message+pos+19) << 8) | (*(message+pos+18)));
-                //Height above mean sea level
-                data.push_back ((*(message+pos+25) << 24) | (*(message+pos+24) << 16) | (*(message+pos+23) << 8) | (*(message+pos+22)));
-                //Horizontal Accuracy Estateimate
-                data.push_back ((unsigned)((*(message+pos+29) << 24) | (*(message+pos+28) << 16) | (*(message+pos+27) << 8) | (*(message+pos+26))));
-                //Vertical Accuracy Estateimate
-                data.push_back ((unsigned)((*(message+pos+33) << 24) | (*(message+pos+32) << 16) | (*(message+pos+31) << 8) | (*(message+pos+30))));
-                break;
+    if ((status = ubx_payload<UBXNavSTATUS>(start, length)) != NULL)
+    {
+        // gpsFix and the flags, which contain gpsFixOk
 
-        case 259:
-                // ID for Nav-Status messages is 0x0103 == 259
-                // This message contains a lot of information, but the reason we use it the GPS fix status
-                // This status is a one byte flag variable, with the offset of 10: first 6 bytes of the captured
-                // message contain message header, id, payload length, next 4 are the first payload variable - iTOW.
-                // We are not interested in it, so we just proceed to the fifth byte - gpsFix flag.
-                // We are also interested in checking the gpsFixOk flag in the next byte/
-                data.clear();
-                // gpsFix
-                data.push_back (*(message+pos+10));
-                // flags, which contain gpsFixOk
-                data.push_back (*(message+pos+11));
+        data.clear();
+        data.push_back(status->gpsFix);
+        data.push_back(status->flags);
+        return UBXNavSTATUS::ID;
+    }
 
-                break;
+    // In case we don't want to decode the received message
+    return 0;
+}
 
-        default:
-                // In case we don't want to decode the received message
-                flag = 0;
+// Function decodeMessage() with a dispatcher hands a verified message to the handlers registered
+// for its type. Returns the message id if it was handled, 0 otherwise.
 
-                break;
-    }
+int UBXParser::decodeMessage(UBXDispatcher& dispatcher)
+{
+    if (!checkMessage())
+        return 0;
 
-    return flag;
+    return dispatcher.dispatch(message + position - length, length);
 }
 
 // Function checkMessage() returns 1 if the message, currently stored in the buffer is valid.
@@ -242,42 +245,108 @@ int UBXParser::decodeMessage(std::vector<double>& data)
 
 int UBXParser::checkMessage()
 {
-    int flag=1;
-    int pos;
-    uint8_t CK_A=0, CK_B=0;
-
     updateMessageData(); // get the length and end message coordinate from UBX scanner
 
-    pos = position-length; // count the message start position
+    return checkMessage(message + position - length, length);
+}
+
+int UBXParser::checkMessage(const unsigned char* msg, unsigned int msg_length)
+{
+    uint8_t CK_A=0, CK_B=0;
+
+    if (msg_length < UBX_HEADER_LENGTH + UBX_CHECKSUM_LENGTH)
+        return 0;
 
     // All UBX messages start with 2 sync chars: 0xb5 and 0x62
 
-    if (*(message+pos)!=0xb5) flag=0;
-    if (*(message+pos+1)!=0x62) flag=0;
+    if (msg[0] != 0xb5 || msg[1] != 0x62)
+        return 0;
 
-    // Count the checksum
+    // The length field has to agree with the message, the checksum covers class, id, length and payload
 
-    for (unsigned int i=2;i<(length-2);i++){
-        CK_A += *(message+pos+i);
+    if (msg[4] + (msg[5] << 8) != (int)(msg_length - UBX_HEADER_LENGTH - UBX_CHECKSUM_LENGTH))
+        return 0;
+
+    for (unsigned int i=2;i<(msg_length-2);i++){
+        CK_A += msg[i];
         CK_B += CK_A;
     }
 
-    if (CK_A != *(message+pos+length-2)) flag=0;
-    if (CK_B != *(message+pos+length-1)) flag=0;
-
-    return flag;
+    return CK_A == msg[msg_length-2] && CK_B == msg[msg_length-1];
 }
 
 // class Ublox
 
-Ublox::Ublox(std::string name) : spi_device_name(name), scanner(new UBXScanner()), parser(new UBXParser(scanner))
+Ublox::Ublox(std::string name) : spi(name.c_str(), 200000), scanner(new UBXScanner()), parser(new UBXParser(scanner)),
+    chunk_position(0), chunk_length(0)
 {
+    memset(tx_chunk, 0, sizeof(tx_chunk));
+}
 
+Ublox::Ublox(std::string name, UBXScanner* scan, UBXParser* pars) : spi(name.c_str(), 200000), scanner(scan), parser(pars),
+    chunk_position(0), chunk_length(0)
+{
+    memset(tx_chunk, 0, sizeof(tx_chunk));
 }
 
-Ublox::Ublox(std::string name, UBXScanner* scan, UBXParser* pars) : spi_device_name(name), scanner(scan), parser(pars)
+// Function readChunk() clocks the next spi_chunk_length bytes out of the receiver in one transfer.
+// We send zeroes, which the receiver ignores. Returns the number of bytes read or -1.
+
+int Ublox::readChunk()
 {
+    chunk_position = 0;
+    chunk_length = 0;
+
+    if (spi.transfer(tx_chunk, rx_chunk, spi_chunk_length) < 0)
+        return -1;
 
+    chunk_length = spi_chunk_length;
+    return chunk_length;
+}
+
+// Function scanStream() feeds the scanner from the receiver stream until it holds a complete
+// message (returns 1), the remaining byte budget is used up (returns 0) or a transfer failed
+// (returns -1). The budget is shared by successive calls, it is decreased by the bytes scanned.
+// Bytes following a message stay in the chunk buffer for the next call.
+// Outside of a message only the first sync char matters, so the 0xff idle filler the receiver
+// sends when it has nothing to say is skipped with memchr instead of byte by byte.
+
+int Ublox::scanStream(unsigned int *remaining)
+{
+    while (*remaining > 0)
+    {
+        if (chunk_position >= chunk_length && readChunk() < 0)
+            return -1;
+
+        unsigned int available = chunk_length - chunk_position;
+        if (available > *remaining)
+            available = *remaining;
+
+        if (scanner->getPosition() == 0)
+        {
+            unsigned char *data = rx_chunk + chunk_position;
+            unsigned char *sync = (unsigned char *)memchr(data, 0xb5, available);
+            unsigned int skipped = sync ? sync - data : available;
+
+            chunk_position += skipped;
+            *remaining -= skipped;
+            if (sync == NULL)
+                continue;
+        }
+
+        while (chunk_position < chunk_length && *remaining > 0)
+        {
+            (*remaining)--;
+            if (scanner->update(rx_chunk[chunk_position++]) == UBXScanner::Done)
+                return 1;
+
+            // Lost sync, go back to looking for the next message start
+            if (scanner->getPosition() == 0)
+                break;
+        }
+    }
+
+    return 0;
 }
 
 int Ublox::enableNAV_POSLLH()
@@ -286,7 +355,7 @@ int Ublox::enableNAV_POSLLH()
     int gps_nav_posllh_length = (sizeof(gps_nav_posllh)/sizeof(*gps_nav_posllh));
     unsigned char from_gps_data_nav[gps_nav_posllh_length];
 
-    return SPIdev::transfer(spi_device_name.c_str(), gps_nav_posllh, from_gps_data_nav, gps_nav_posllh_length, 200000);
+    return spi.transfer(gps_nav_posllh, from_gps_data_nav, gps_nav_posllh_length);
 }
 
 int Ublox::enableNAV_STATUS()
@@ -295,14 +364,72 @@ int Ublox::enableNAV_STATUS()
     int gps_nav_status_length = (sizeof(gps_nav_status)/sizeof(*gps_nav_status));
     unsigned char from_gps_data_nav[gps_nav_status_length];
 
-    return SPIdev::transfer(spi_device_name.c_str(), gps_nav_status, from_gps_data_nav, gps_nav_status_length, 200000);
+    return spi.transfer(gps_nav_status, from_gps_data_nav, gps_nav_status_length);
+}
+
+// Function sendMessage() frames a payload as UBX message and sends it to the receiver.
+// The bytes clocked out of the receiver during the transfer are dropped, so it is meant for
+// configuration before the stream is read.
+
+int Ublox::sendMessage(uint16_t id, const void* payload, unsigned int payload_length)
+{
+    unsigned char tx[buffer_length];
+    unsigned char rx[buffer_length];
+    unsigned int length = UBX_HEADER_LENGTH + payload_length + UBX_CHECKSUM_LENGTH;
+    uint8_t CK_A=0, CK_B=0;
+
+    if (length > sizeof(tx))
+        return -1;
+
+    tx[0] = 0xb5;
+    tx[1] = 0x62;
+    tx[2] = id >> 8;
+    tx[3] = id & 0xff;
+    tx[4] = payload_length & 0xff;
+    tx[5] = payload_length >> 8;
+    memcpy(tx + UBX_HEADER_LENGTH, payload, payload_length);
+
+    for (unsigned int i=2;i<(length-2);i++){
+        CK_A += tx[i];
+        CK_B += CK_A;
+    }
+    tx[length-2] = CK_A;
+    tx[length-1] = CK_B;
+
+    return spi.transfer(tx, rx, length);
+}
+
+// Function enableMessage() sets the output rate of a message on the SPI port with CFG-MSG,
+// rate is the number of navigation solutions per message, 0 disables the message
+
+int Ublox::enableMessage(uint16_t id, uint8_t rate)
+{
+    UBXCfgMSG cfg;
+
+    cfg.msgClass = id >> 8;
+    cfg.msgID = id & 0xff;
+    cfg.rate = rate;
+
+    return sendMessage(UBXCfgMSG::ID, &cfg, sizeof(cfg));
+}
+
+// Function setMeasurementRate() sets the navigation solution period with CFG-RATE, aligned to GPS time
+
+int Ublox::setMeasurementRate(uint16_t period_ms)
+{
+    UBXCfgRATE cfg;
+
+    cfg.measRate = period_ms;
+    cfg.navRate = 1;
+    cfg.timeRef = 1;
+
+    return sendMessage(UBXCfgRATE::ID, &cfg, sizeof(cfg));
 }
 
 int Ublox::testConnection()
 {
     int status;
-    int count = 0;
-    unsigned char to_gps_data = 0x00, from_gps_data = 0x00;
+    unsigned int remaining = buffer_length/2;
 
     // we do this, so that at least one ubx message is enabled
 
@@ -316,31 +443,21 @@ int Ublox::testConnection()
         std::cerr << "Could not configure ublox over SPI\n";
     }
 
-    while (count < buffer_length/2)
+    // From now on, we will read the stream coming over SPI in chunks, the scanner checks
+    // the message structure with every byte received
+    while ((status = scanStream(&remaining)) == 1)
     {
-        // From now on, we will send zeroes to the receiver, which it will ignore
-        // However, we are simultaneously getting useful information from it
-        SPIdev::transfer(spi_device_name.c_str(), &to_gps_data, &from_gps_data, 1, 200000);
-
-        // Scanner checks the message structure with every byte received
-        status = scanner->update(from_gps_data);
+        // Once we have a full message we decode it and reset the scanner, making it look for another message
+        // in the data stream, coming over SPI
 
-        if (status == UBXScanner::Done)
+        // If we find at least one valid message in the buffer, we consider connection to be established
+        if(parser->checkMessage()==1)
         {
-            // Once we have a full message we decode it and reset the scanner, making it look for another message
-            // in the data stream, coming over SPI
-
-            // If we find at least one valid message in the buffer, we consider connection to be established
-            if(parser->checkMessage()==1)
-            {
-                scanner->reset();
-                return 1;
-            }
-
             scanner->reset();
+            return 1;
         }
 
-        count++;
+        scanner->reset();
     }
 
     return 0;
@@ -349,7 +466,6 @@ int Ublox::testConnection()
 int Ublox::decodeMessages()
 {
     int status;
-    unsigned char to_gps_data = 0x00, from_gps_data = 0x00;
     std::vector<double> position_data;
 
     if (enableNAV_POSLLH()<0)
@@ -364,14 +480,12 @@ int Ublox::decodeMessages()
 
     while (true)
     {
-        // From now on, we will send zeroes to the receiver, which it will ignore
-        // However, we are simultaneously getting useful information from it
-        SPIdev::transfer(spi_device_name.c_str(), &to_gps_data, &from_gps_data, 1, 200000);
-
+        // From now on, we will read the stream coming over SPI in chunks
         // Scanner checks the message structure with every byte received
-        status = scanner->update(from_gps_data);
+        unsigned int remaining = spi_chunk_length;
+        status = scanStream(&remaining);
 
-        if (status == UBXScanner::Done)
+        if (status == 1)
         {
             // Once we have a full message we decode it and reset the scanner, making it look for another message
             // in the data stream, coming over SPI
@@ -432,61 +546,81 @@ int Ublox::decodeMessages()
 
             scanner->reset();
         }
-
-        usleep(200);
+        else if (status < 0 || scanner->getPosition() == 0)
+        {
+            // A chunk without the start of a message is idle filler, give the receiver time
+            usleep(spi_idle_us);
+        }
 
     }
 
     return 0 ;
 }
 
+// Function pollMessages() reads one chunk budget of the stream and hands every complete, valid
+// message to the dispatcher. Unlike decodeMessages() it returns, so it can be called from a loop
+// that decides itself when to sleep: idle is set if the receiver sent only filler and no message
+// is in progress. Returns the number of valid messages or -1 if the transfer failed.
+
+int Ublox::pollMessages(UBXDispatcher& dispatcher, bool* idle)
+{
+    unsigned int remaining = spi_chunk_length;
+    int count = 0;
+    int status;
+
+    while ((status = scanStream(&remaining)) == 1)
+    {
+        if (parser->checkMessage() == 1)
+        {
+            dispatcher.dispatch(scanner->getMessage() + scanner->getPosition() - scanner->getMessageLength(),
+                                scanner->getMessageLength());
+            count++;
+        }
+
+        scanner->reset();
+    }
+
+    if (idle != NULL)
+        *idle = count == 0 && scanner->getPosition() == 0;
+
+    return status < 0 ? -1 : count;
+}
+
 int Ublox::decodeSingleMessage(message_t msg, std::vector<double>& position_data)
 {
     switch(msg){
         case NAV_POSLLH:
             {
-                uint16_t id = 0x0102;
-                int status;
-                int count = 0;
-                unsigned char to_gps_data = 0x00, from_gps_data = 0x00;
+                uint16_t id = UBXNavPOSLLH::ID;
 
-                while (count < buffer_length/2)
+                // From now on, we will read the stream coming over SPI in chunks, the scanner checks
+                // the message structure with every byte received
+                unsigned int remaining = buffer_length/2;
+                while (scanStream(&remaining) == 1)
                 {
-                    // From now on, we will send zeroes to the receiver, which it will ignore
-                    // However, we are simultaneously getting useful information from it
-                    SPIdev::transfer(spi_device_name.c_str(), &to_gps_data, &from_gps_data, 1, 200000);
-
-                    // Scanner checks the message structure with every byte received
-                    status = scanner->update(from_gps_data);
-
-                    if (status == UBXScanner::Done)
+                    // Once we have a full message we decode it and reset the scanner, making it look for another message
+                    // in the data stream, coming over SPI
+                    if(parser->decodeMessage(position_data) == id)
                     {
-                        // Once we have a full message we decode it and reset the scanner, making it look for another message
-                        // in the data stream, coming over SPI
-                        if(parser->decodeMessage(position_data) == id)
-                        {
-                            // Now let's do something with the extracted information
-                            // in case of NAV-POSLLH messages we can print the information like this:
-                            // printf("GPS Millisecond Time of Week: %lf\n", position_data[0]/1000);
-                            // printf("Longitude: %lf\n", position_data[1]/10000000);
-                            // printf("Latitude: %lf\n", position_data[2]/10000000);
-                            // printf("Height above Ellipsoid: %.3lf m\n", pos_data[3]/1000);
-                            // printf("Height above mean sea level: %.3lf m\n", pos_data[4]/1000);
-                            // printf("Horizontal Accuracy Estateimate: %.3lf m\n", pos_data[5]/1000);
-                            // printf("Vertical Accuracy Estateimate: %.3lf m\n", pos_data[6]/1000);
-
+                        // Now let's do something with the extracted information
+                        // in case of NAV-POSLLH messages we can print the information like this:
+                        // printf("GPS Millisecond Time of Week: %lf\n", position_data[0]/1000);
+                        // printf("Longitude: %lf\n", position_data[1]/10000000);
+                        // printf("Latitude: %lf\n", position_data[2]/10000000);
+                        // printf("Height above Ellipsoid: %.3lf m\n", pos_data[3]/1000);
+                        // printf("Height above mean sea level: %.3lf m\n", pos_data[4]/1000);
+                        // printf("Horizontal Accuracy Estateimate: %.3lf m\n", pos_data[5]/1000);
+                        // printf("Vertical Accuracy Estateimate: %.3lf m\n", pos_data[6]/1000);
 
-                            // You can see ubx message structure in ublox reference manual
 
-                            scanner->reset();
-
-                            return 1;
-                        }
+                        // You can see ubx message structure in ublox reference manual
 
                         scanner->reset();
+
+                        return 1;
                     }
 
-                    count++;
+                    scanner->reset();
                 }
 
                 return 0;
@@ -496,77 +630,65 @@ int Ublox::decodeSingleMessage(message_t msg, std::vector<double>& position_data
 
         case NAV_STATUS:
             {
-                uint16_t id = 0x0103;
-                int status;
-                int count = 0;
-                unsigned char to_gps_data = 0x00, from_gps_data = 0x00;
+                uint16_t id = UBXNavSTATUS::ID;
 
-                while (count < buffer_length/2)
+                // From now on, we will read the stream coming over SPI in chunks, the scanner checks
+                // the message structure with every byte received
+                unsigned int remaining = buffer_length/2;
+                while (scanStream(&remaining) == 1)
                 {
-                    // From now on, we will send zeroes to the receiver, which it will ignore
-                    // However, we are simultaneously getting useful information from it
-                    SPIdev::transfer(spi_device_name.c_str(), &to_gps_data, &from_gps_data, 1, 200000);
-
-                    // Scanner checks the message structure with every byte received
-                    status = scanner->update(from_gps_data);
-
-                    if (status == UBXScanner::Done)
+                    // Once we have a full message we decode it and reset the scanner, making it look for another message
+                    // in the data stream, coming over SPI
+                    if(parser->decodeMessage(position_data) == id)
                     {
-                        // Once we have a full message we decode it and reset the scanner, making it look for another message
-                        // in the data stream, coming over SPI
-                        if(parser->decodeMessage(position_data) == id)
-                        {
-                            // Now let's do something with the extracted information
-                            // in case of NAV-STATUS messages we can do this:
-                            //
-                            // printf("Current GPS status:\n");
-                            // printf("gpsFixOk: %d\n", ((int)pos_data[1] & 0x01));
-                            //
-                            // printf("gps Fix status: ");
-                            // switch((int)pos_data[0]){
-                            //     case 0x00:
-                            //         printf("no fix\n");
-                            //         break;
-                            //
-                            //     case 0x01:
-                            //         printf("dead reckoning only\n");
-                            //         break;
-                            //
-                            //     case 0x02:
-                            //         printf("2D-fix\n");
-                            //         break;
-                            //
-                            //     case 0x03:
-                            //         printf("3D-fix\n");
-                            //         break;
-                            //
-                            //     case 0x04:
-                            //         printf("GPS + dead reckoning combined\n");
-                            //         break;
-                            //
-                            //     case 0x05:
-                            //         printf("Time only fix\n");
-                            //         break;
-                            //
-                            //     default:
-                            //         printf("Reserved value. Current state unknown\n");
-                            //         break;
-                            //
-                            // }
-                            //
-                            // printf("\n");
-
-                            // You can see ubx message structure in ublox reference manual
-
-                            scanner->reset();
-
-                            return 1;
-                        }
+                        // Now let's do something with the extracted information
+                        // in case of NAV-STATUS messages we can do this:
+                        //
+                        // printf("Current GPS status:\n");
+                        // printf("gpsFixOk: %d\n", ((int)pos_data[1] & 0x01));
+                        //
+                        // printf("gps Fix status: ");
+                        // switch((int)pos_data[0]){
+                        //     case 0x00:
+                        //         printf("no fix\n");
+                        //         break;
+                        //
+                        //     case 0x01:
+                        //         printf("dead reckoning only\n");
+                        //         break;
+                        //
+                        //     case 0x02:
+                        //         printf("2D-fix\n");
+                        //         break;
+                        //
+                        //     case 0x03:
+                        //         printf("3D-fix\n");
+                        //         break;
+                        //
+                        //     case 0x04:
+                        //         printf("GPS + dead reckoning combined\n");
+                        //         break;
+                        //
+                        //     case 0x05:
+                        //         printf("Time only fix\n");
+                        //         break;
+                        //
+                        //     default:
+                        //         printf("Reserved value. Current state unknown\n");
+                        //         break;
+                        //
+                        // }
+                        //
+                        // printf("\n");
+
+                        // You can see ubx message structure in ublox reference manual
 
                         scanner->reset();
+
+                        return 1;
                     }
 
-                    count++;
+                    scanner->reset();
                 }
 
                 return 0;
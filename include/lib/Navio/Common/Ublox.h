@@ -27,6 +27,9 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifndef _UBLOX_H_
+#define _UBLOX_H_
+
 //#define _XOPEN_SOURCE 600
 #include <unistd.h>
 #include <fcntl.h>
@@ -42,8 +45,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <vector>
 #include "SPIdev.h"
+#include "UBXMessages.h"
 
 static const int buffer_length = 1024;
+static const int spi_chunk_length = 128;    // bytes clocked out of the receiver per SPI transfer
+static const int spi_idle_us = 10000;       // wait after a chunk of idle filler
 
 class UBXScanner {
 public:
@@ -78,6 +84,60 @@ public:
     int update(unsigned char data);
 };
 
+// Returns the payload of a verified message as T, or NULL if the message has another
+// class/id or is too short for T. The pointer refers to the message buffer, no copy is made.
+
+template <class T>
+const T* ubx_payload(const unsigned char* message, unsigned int length)
+{
+    if (length < UBX_HEADER_LENGTH + sizeof(T) + UBX_CHECKSUM_LENGTH)
+        return NULL;
+    if (UBX_ID(message[2], message[3]) != T::ID)
+        return NULL;
+    return (const T*)(message + UBX_HEADER_LENGTH);
+}
+
+// Dispatch table keyed on class/id. A handler gets the payload of its message type
+// in place, it is only valid during the call.
+
+class UBXDispatcher{
+public:
+    static const int max_handlers = 16;
+
+    UBXDispatcher();
+
+    template <class T>
+    bool add(void (*handler)(void* arg, const T* payload), void* arg)
+    {
+        return add(T::ID, sizeof(T), (Generic)handler, &call<T>, arg);
+    }
+
+    int dispatch(const unsigned char* message, unsigned int length);
+
+private:
+    typedef void (*Generic)();
+    typedef void (*Thunk)(Generic handler, void* arg, const unsigned char* payload);
+
+    struct Entry {
+        uint16_t id;
+        unsigned int min_length; // message length including header and checksum
+        Generic handler;
+        Thunk thunk;
+        void* arg;
+    };
+
+    template <class T>
+    static void call(Generic handler, void* arg, const unsigned char* payload)
+    {
+        ((void (*)(void*, const T*))handler)(arg, (const T*)payload);
+    }
+
+    bool add(uint16_t id, unsigned int payload_length, Generic handler, Thunk thunk, void* arg);
+
+    Entry entries[max_handlers];
+    int count;
+};
+
 class UBXParser{
 private:
     UBXScanner* scanner; // pointer to the scanner, which finds the messages in the data stream
@@ -89,7 +149,20 @@ public:
     UBXParser(UBXScanner* ubxsc);
     void updateMessageData();
     int decodeMessage(std::vector<double>& data);
+    int decodeMessage(UBXDispatcher& dispatcher);
     int checkMessage();
+    static int checkMessage(const unsigned char* msg, unsigned int msg_length);
+
+    // Typed view of the current message, NULL if it is not a valid T
+    template <class T>
+    const T* getPayload()
+    {
+        updateMessageData();
+        const unsigned char* start = message + position - length;
+        if (!checkMessage(start, length))
+            return NULL;
+        return ubx_payload<T>(start, length);
+    }
 };
 
 class Ublox {
@@ -101,16 +174,30 @@ enum message_t
 };
 
 private:
-    std::string spi_device_name;
+    SPIdev spi;
     UBXScanner* scanner;
     UBXParser* parser;
 
+    unsigned char tx_chunk[spi_chunk_length];   // zeroes, ignored by the receiver
+    unsigned char rx_chunk[spi_chunk_length];   // last chunk of the receiver stream
+    unsigned int chunk_position;                // next unscanned byte of rx_chunk
+    unsigned int chunk_length;                  // valid bytes in rx_chunk
+
+    int readChunk();
+    int scanStream(unsigned int *remaining);
+
 public:
     Ublox(std::string name = "/dev/spidev0.0");
     Ublox(std::string name, UBXScanner* scan, UBXParser* pars);
     int enableNAV_POSLLH();
     int enableNAV_STATUS();
+    int sendMessage(uint16_t id, const void* payload, unsigned int payload_length);
+    int enableMessage(uint16_t id, uint8_t rate);
+    int setMeasurementRate(uint16_t period_ms);
     int testConnection();
     int decodeMessages();
+    int pollMessages(UBXDispatcher& dispatcher, bool* idle);
     int decodeSingleMessage(message_t msg, std::vector<double>& position_data);
 }; // end of ublox class def
+
+#endif // _UBLOX_H_
@@ -6,57 +6,10 @@
 #include <unistd.h>
 
 #include "Util.h"
+#include "SysfsAttr.h"
 
 #define SCRIPT_PATH "../../../check_apm.sh"
 
-int write_file(const char *path, const char *fmt, ...)
-{
-    errno = 0;
-
-    int fd = ::open(path, O_WRONLY | O_CLOEXEC);
-    if (fd == -1) {
-        return -errno;
-    }
-
-    va_list args;
-    va_start(args, fmt);
-
-    int ret = ::vdprintf(fd, fmt, args);
-    int errno_bkp = errno;
-    ::close(fd);
-
-    va_end(args);
-
-    if (ret < 1) {
-        return -errno_bkp;
-    }
-
-    return ret;
-}
-
-int read_file(const char *path, const char *fmt, ...)
-{
-    errno = 0;
-
-    FILE *file = ::fopen(path, "re");
-    if (!file)
-        return -errno;
-
-    va_list args;
-    va_start(args, fmt);
-
-    int ret = ::vfscanf(file, fmt, args);
-    int errno_bkp = errno;
-    ::fclose(file);
-
-    va_end(args);
-
-    if (ret < 1)
-        return -errno_bkp;
-
-    return ret;
-}
-
 bool check_apm()
 {
     int ret =  system("ps -AT | grep -c ap-timer > /dev/null");
@@ -71,7 +24,7 @@ bool check_apm()
 
 int get_navio_version()
 {
-    int version;
-    read_file("/sys/firmware/devicetree/base/hat/product_id", "%x",&version);
+    long version = 0;
+    SysfsAttr::read_once_int("/sys/firmware/devicetree/base/hat/product_id", &version, 16);
     return version;
 }
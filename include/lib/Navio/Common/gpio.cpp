@@ -2,8 +2,11 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <linux/gpio.h>
 #include <err.h>
 
 #include <cstdio>
@@ -35,45 +38,24 @@
 
 using namespace Navio;
 
-Pin::Pin(uint8_t pin):
-    _pin(pin),
-    _gpio(NULL), 
-    _mode(GpioModeInput)
-{
-}
-
-Pin::~Pin()
-{
-    if (!_deinit()) {
-        warnx("deinitialization failed");
-    }
-}
-
-bool Pin::_deinit() 
-{
-    if (munmap(const_cast<uint32_t *>(_gpio), BLOCK_SIZE) < 0) {
-        warnx("unmap failed");
-        return false;
-    }
-    return true;
-}
+static int detectRaspberryPiVersion();
 
-bool Pin::init()
+/* Maps the GPIO register block, NULL on error */
+static volatile uint32_t *mapGpioRegisters(int version)
 {
     int mem_fd;
     if ((mem_fd = open("/dev/mem", O_RDWR|O_SYNC) ) < 0) {
         warn("/dev/mem cannot be opened");
-        return false;
+        return NULL;
     }
 
     uint32_t address;
-    int version = getRaspberryPiVersion();
-    if (version == 1) {
-        address = GPIO_BASE(BCM2708_PERI_BASE);
-    } else if (version == 2) {
+    if (version == 2) {
         address = GPIO_BASE(BCM2709_PERI_BASE);
     } else if (version == 3) {
         address = GPIO_BASE(BCM2835_PERI_BASE);
+    } else {
+        address = GPIO_BASE(BCM2708_PERI_BASE);
     }
 
     void *gpio_map = mmap(
@@ -85,22 +67,52 @@ bool Pin::init()
         address               /* offset to GPIO peripheral */
     );
 
+    /* No need to keep mem_fd open after mmap */
+    if (close(mem_fd) < 0) {
+        warn("cannot close mem_fd");
+    }
+
     if (gpio_map == MAP_FAILED) {
         warn("cannot mmap memory");
-        return false;
+        return NULL;
     }
 
-    /* No need to keep mem_fd open after mmap */
-    if (close(mem_fd) < 0) {
-        warn("cannot close mem_fd");   
-        return false;
-    } 
+    return reinterpret_cast<volatile uint32_t *>(gpio_map); // Always use volatile pointer!
+}
 
-    _gpio = reinterpret_cast<volatile uint32_t *>(gpio_map); // Always use volatile pointer!
+Pin::Pin(uint8_t pin):
+    _pin(pin),
+    _gpio(NULL), 
+    _mode(GpioModeInput)
+{
+}
 
+Pin::~Pin()
+{
+    if (!_deinit()) {
+        warnx("deinitialization failed");
+    }
+}
+
+bool Pin::_deinit() 
+{
+    if (_gpio == NULL) {
+        return true;
+    }
+
+    if (munmap(const_cast<uint32_t *>(_gpio), BLOCK_SIZE) < 0) {
+        warnx("unmap failed");
+        return false;
+    }
     return true;
 }
 
+bool Pin::init()
+{
+    _gpio = mapGpioRegisters(getRaspberryPiVersion());
+    return _gpio != NULL;
+}
+
 void Pin::setMode(GpioMode mode)
 {
     if (mode == GpioModeInput) {
@@ -138,6 +150,11 @@ void Pin::toggle()
 }
 
 int Pin::getRaspberryPiVersion() const
+{
+    return detectRaspberryPiVersion();
+}
+
+static int detectRaspberryPiVersion()
 {
     char buffer[MAX_SIZE_LINE];
     const char* hardware_description_entry = "Hardware";
@@ -171,3 +188,160 @@ int Pin::getRaspberryPiVersion() const
     fclose(fd);
     return 1;
 }
+
+GpioBank::GpioBank():
+    _gpio(NULL)
+{
+}
+
+GpioBank::~GpioBank()
+{
+    if (_gpio != NULL && munmap(const_cast<uint32_t *>(_gpio), BLOCK_SIZE) < 0) {
+        warnx("unmap failed");
+    }
+}
+
+bool GpioBank::init()
+{
+    if (_gpio == NULL) {
+        _gpio = mapGpioRegisters(detectRaspberryPiVersion());
+    }
+    return _gpio != NULL;
+}
+
+void GpioBank::setOutputs(uint32_t mask)
+{
+    for (int pin = 0; pin < 32; pin++) {
+        if (mask & (1u << pin)) {
+            GPIO_MODE_IN(pin);
+            GPIO_MODE_OUT(pin);
+        }
+    }
+}
+
+void GpioBank::setInputs(uint32_t mask)
+{
+    for (int pin = 0; pin < 32; pin++) {
+        if (mask & (1u << pin)) {
+            GPIO_MODE_IN(pin);
+        }
+    }
+}
+
+GpioEdgeEvents::GpioEdgeEvents(uint8_t pin, const char *chip):
+    _pin(pin),
+    _chip(chip),
+    _fd(-1)
+{
+}
+
+GpioEdgeEvents::~GpioEdgeEvents()
+{
+    close();
+}
+
+bool GpioEdgeEvents::open(Pin::GpioEdge edge)
+{
+    static const uint32_t flags[] = {0, GPIOEVENT_REQUEST_RISING_EDGE,
+                                     GPIOEVENT_REQUEST_FALLING_EDGE, GPIOEVENT_REQUEST_BOTH_EDGES};
+
+    close();
+    if (edge == Pin::GpioEdgeNone) {
+        return true;
+    }
+
+    int chip_fd = ::open(_chip, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) {
+        warn("cannot open %s", _chip);
+        return false;
+    }
+
+    struct gpioevent_request request;
+    memset(&request, 0, sizeof(request));
+    request.lineoffset = _pin;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    request.eventflags = flags[edge];
+    strncpy(request.consumer_label, "navio", sizeof(request.consumer_label) - 1);
+
+    int ret = ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &request);
+    ::close(chip_fd);
+    if (ret < 0) {
+        warn("cannot request edge events of gpio %u", _pin);
+        return false;
+    }
+
+    /* read() drains the queue without blocking, wait() polls first */
+    _fd = request.fd;
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+void GpioEdgeEvents::close()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+/* Kernels before 5.7 stamp line events with CLOCK_REALTIME, later ones with
+   CLOCK_MONOTONIC. A realtime stamp lies far in the monotonic future. */
+uint64_t GpioEdgeEvents::_toMonotonic(uint64_t timestamp) const
+{
+    struct timespec mono, real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+
+    uint64_t mono_ns = (uint64_t)mono.tv_sec * 1000000000 + mono.tv_nsec;
+    uint64_t real_ns = (uint64_t)real.tv_sec * 1000000000 + real.tv_nsec;
+    if (timestamp <= mono_ns) {
+        return timestamp;
+    }
+    return timestamp - (real_ns - mono_ns);
+}
+
+int GpioEdgeEvents::read(GpioEvent *events, int count)
+{
+    if (_fd < 0) {
+        return -1;
+    }
+
+    int n = 0;
+    while (n < count) {
+        struct gpioevent_data data;
+        ssize_t ret = ::read(_fd, &data, sizeof(data));
+        if (ret < 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+            return n > 0 ? n : -1;
+        }
+        if (ret != sizeof(data)) {
+            break;
+        }
+
+        events[n].timestamp = _toMonotonic(data.timestamp);
+        events[n].rising = data.id == GPIOEVENT_EVENT_RISING_EDGE;
+        n++;
+    }
+    return n;
+}
+
+int GpioEdgeEvents::wait(GpioEvent *event, int timeout_ms)
+{
+    if (_fd < 0) {
+        return -1;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = _fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0) {
+        return ret;
+    }
+
+    return read(event, 1) == 1 ? 1 : -1;
+}
@@ -2,6 +2,7 @@
 #ifndef __NAVIO_GPIO_H__
 #define __NAVIO_GPIO_H__
 
+#include <cstddef>
 #include <stdint.h>
 
 namespace Navio {
@@ -37,6 +38,13 @@ public:
         GpioModeOutput
     } GpioMode;
 
+    typedef enum {
+        GpioEdgeNone,
+        GpioEdgeRising,
+        GpioEdgeFalling,
+        GpioEdgeBoth
+    } GpioEdge;
+
     Pin(uint8_t pin);
     ~Pin();
 
@@ -58,6 +66,78 @@ private:
     bool    _deinit();
 };
 
+/* Pins 0-31 driven through one mapping of the GPIO registers. set(), clear()
+   and write() change every pin of a mask with one register store each, so
+   several pins switch together at the cost of a single uncached write.
+   The inline accessors do no checks, init() has to succeed first. */
+class GpioBank {
+public:
+    GpioBank();
+    ~GpioBank();
+
+    bool     init();
+    bool     isInitialized() const { return _gpio != NULL; }
+    void     setOutputs(uint32_t mask);
+    void     setInputs(uint32_t mask);
+
+    void     set(uint32_t mask)   { _gpio[GPSET0] = mask; }
+    void     clear(uint32_t mask) { _gpio[GPCLR0] = mask; }
+    /* Two stores back to back, set and clear pins change a few ns apart */
+    void     write(uint32_t set_mask, uint32_t clear_mask)
+    {
+        _gpio[GPSET0] = set_mask;
+        _gpio[GPCLR0] = clear_mask;
+    }
+    uint32_t read() const { return _gpio[GPLEV0]; }
+
+    static uint32_t mask(uint8_t pin) { return 1u << pin; }
+
+private:
+    static const int GPSET0 = 7;
+    static const int GPCLR0 = 10;
+    static const int GPLEV0 = 13;
+
+    GpioBank(const GpioBank&);
+    GpioBank& operator=(const GpioBank&);
+
+    volatile uint32_t *_gpio;
+};
+
+/* Edge of an input pin as seen by the kernel */
+struct GpioEvent {
+    uint64_t timestamp;     // ns, CLOCK_MONOTONIC, taken in the interrupt handler
+    bool     rising;
+};
+
+/* Edge events of one pin from the gpiochip character device. The kernel
+   timestamps every edge in its interrupt handler and queues the events, so
+   neither the time nor a burst of edges is lost to a late reader.
+   fd() can be polled together with other descriptors. */
+class GpioEdgeEvents {
+public:
+    GpioEdgeEvents(uint8_t pin, const char *chip = "/dev/gpiochip0");
+    ~GpioEdgeEvents();
+
+    bool    open(Pin::GpioEdge edge);
+    void    close();
+    int     fd() const { return _fd; }
+
+    /* Returns 1 with the oldest queued edge, 0 on timeout and -1 on error */
+    int     wait(GpioEvent *event, int timeout_ms);
+    /* Takes up to count queued edges without blocking, -1 on error */
+    int     read(GpioEvent *events, int count);
+
+private:
+    GpioEdgeEvents(const GpioEdgeEvents&);
+    GpioEdgeEvents& operator=(const GpioEdgeEvents&);
+
+    uint64_t _toMonotonic(uint64_t timestamp) const;
+
+    uint8_t _pin;
+    const char *_chip;
+    int _fd;
+};
+
 }
 
 #endif // __NAVIO_GPIO_H__
@@ -5,21 +5,36 @@ ADC_Navio::ADC_Navio()
 
 }
 
-void ADC_Navio::initialize()
+ADC_Navio::~ADC_Navio()
 {
-    ADS1115 adc;
+    adc.stopScan();
+}
 
+void ADC_Navio::initialize()
+{
     adc.setMode(ADS1115_MODE_SINGLESHOT);
     adc.setRate(ADS1115_RATE_860);
+
+    /* Keep all channels converting in the background, read() only picks up the latest values */
+    if (!adc.startScan(muxes, ARRAY_SIZE(muxes)))
+        fprintf(stderr, "ADC scan not started, reads will wait for the conversion\n");
 }
 
 int ADC_Navio::read(int ch)
 {
-    if (ch > ARRAY_SIZE(muxes))
+    if (ch < 0 || ch >= (int)ARRAY_SIZE(muxes))
     {
         fprintf(stderr,"Channel number too large\n");
         return -1;
     }
+
+    ADS1115Sample sample;
+    if (adc.isScanning()) {
+        if (adc.getScanSample(ch, &sample))
+            results[ch] = sample.milliVolts;
+        return results[ch];
+    }
+
     adc.setMultiplexer(muxes[ch]);
 
     float conversion = adc.getMilliVolts();
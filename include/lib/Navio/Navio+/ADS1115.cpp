@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "ADS1115.h"
 
@@ -43,7 +44,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 ADS1115::ADS1115(uint8_t address) {
     this->address = address;
+    scanCount = 0;
+    scanning = false;
+    alert = NULL;
+    sem_init(&scanDone, 0, 0);
     memset(&config, 0, sizeof(config));
+    memset(scanTable, 0, sizeof(scanTable));
     setGain(ADS1115_PGA_4P096);
     setMultiplexer(ADS1115_MUX_P0_NG);
     setMode(ADS1115_MODE_SINGLESHOT);
@@ -51,7 +57,8 @@ ADS1115::ADS1115(uint8_t address) {
 }
 
 ADS1115::~ADS1115() {
-
+    stopScan();
+    sem_destroy(&scanDone);
 }
 
 /** Verify the I2C connection.
@@ -70,18 +77,20 @@ bool ADS1115::testConnection() {
  * @brief Call it if you updated ConfigRegister
  */
 void ADS1115::updateConfigRegister() {
-    uint16_t c;
-
-    /* New config */
-    c = config.status | config.mux | config.gain |
-        config.mode | config.rate | config.comparator |
-        config.polarity | config.latch | config.queue;
-
-    if ( I2Cdev::writeWord(address, ADS1115_RA_CONFIG, c) < 0) {
+    if ( !I2Cdev::writeWord(address, ADS1115_RA_CONFIG, getConfigWord()) ) {
         fprintf(stderr, "Error while writing config\n");
     }
 }
 
+/**
+ * @brief Config register value of the current settings
+ */
+uint16_t ADS1115::getConfigWord() {
+    return config.status | config.mux | config.gain |
+           config.mode | config.rate | config.comparator |
+           config.polarity | config.latch | config.queue;
+}
+
 /**
  * @brief Get data from Conversion Register
  *
@@ -95,14 +104,31 @@ int16_t ADS1115::getConversion() {
     word.w = 0;
 
     if (config.mode == ADS1115_MODE_SINGLESHOT ) {
-        /* Check for Operation Status. If it is 0 then we are ready to get data. Otherwise wait. */
+        /* Sleep through the conversion instead of polling the bus for all of it */
         setOpStatus(ADS1115_OS_ACTIVE);
+        usleep(getConversionTimeUs());
+        /* Check for Operation Status. If it is 0 then we are ready to get data. Otherwise wait. */
         while ((word.w & 0x80) == 0) {
             if ( I2Cdev::readWord(address, ADS1115_RA_CONFIG, &word.w) < 0 )
                 fprintf(stderr, "Error while reading config\n");
         }
     }
 
+    return readConversion();
+}
+
+/**
+ * @brief Read the Conversion Register without starting or waiting for a conversion
+ *
+ * @return Little-Endian result
+ */
+int16_t ADS1115::readConversion() {
+    union {
+        uint16_t w;
+        uint8_t b[2];
+    } word;
+    word.w = 0;
+
     if ( (I2Cdev::readWord(address, ADS1115_RA_CONVERSION, &word.w)) < 0 ) {
         fprintf(stderr, "Error while reading\n");
     }
@@ -111,6 +137,19 @@ int16_t ADS1115::getConversion() {
     return (int16_t) word.w;
 }
 
+/**
+ * @brief Duration of one conversion at the current rate, with a margin
+ * for the +-10% tolerance of the internal oscillator
+ *
+ * @return Conversion time in us
+ */
+unsigned int ADS1115::getConversionTimeUs() {
+    static const unsigned int samplesPerSecond[] = {8, 16, 32, 64, 128, 250, 475, 860};
+    unsigned int sps = samplesPerSecond[(config.rate >> ADS1115_RATE_SHIFT) & 0x07];
+
+    return 1100000 / sps + 50;
+}
+
 /**
  * @brief Update Operational Status
  *
@@ -225,31 +264,37 @@ void ADS1115::showConfigRegister() {
  * @return Last conversion in mV
  */
 float ADS1115::getMilliVolts() {
+  float scale = getMilliVoltsPerBit();
+  if (scale < 0) {
+      return -1;
+  }
+  return getConversion() * scale;
+}
+
+/**
+ * @brief Get the weight of one conversion step for the current gain
+ *
+ * @return mV per bit, -1 for an invalid gain
+ */
+float ADS1115::getMilliVoltsPerBit() {
   switch (config.gain) {
     case ADS1115_PGA_6P144:
-      return (getConversion() * ADS1115_MV_6P144);
-      break;
+      return ADS1115_MV_6P144;
     case ADS1115_PGA_4P096:
-      return (getConversion() * ADS1115_MV_4P096);
-      break;
+      return ADS1115_MV_4P096;
     case ADS1115_PGA_2P048:
-      return (getConversion() * ADS1115_MV_2P048);
-      break;
+      return ADS1115_MV_2P048;
     case ADS1115_PGA_1P024:
-      return (getConversion() * ADS1115_MV_1P024);
-      break;
+      return ADS1115_MV_1P024;
     case ADS1115_PGA_0P512:
-      return (getConversion() * ADS1115_MV_0P512);
-      break;
+      return ADS1115_MV_0P512;
     case ADS1115_PGA_0P256:
     case ADS1115_PGA_0P256B:
     case ADS1115_PGA_0P256C:
-      return (getConversion() * ADS1115_MV_0P256);
-      break;
+      return ADS1115_MV_0P256;
     default:
       fprintf(stderr, "Wrong gain\n");
       return -1;
-      break;
   }
 }
 
@@ -301,3 +346,274 @@ void ADS1115::setComparatorQueueMode(uint16_t queue) {
     }
 
 }
+
+/**
+ * @brief Start converting the given multiplexer settings in turn on a background thread
+ *
+ * The latest result of every channel is kept in a table that getScanSample()
+ * reads without locking or touching the bus. A single channel runs the ADC in
+ * continuous mode. With several channels every step starts a single-shot
+ * conversion on the next channel, so that no result mixes two inputs.
+ * End of conversion is signalled by the ALERT/RDY output on alertPin, or
+ * taken from the conversion time of the current rate if no pin is given.
+ * The scan thread goes through the I2C scheduler at low priority, so that
+ * motor and sensor transfers pass ahead of it.
+ * Gain and rate must be set before, the config setters must not be
+ * called while scanning.
+ *
+ * @param muxes multiplexer settings, channel n of the table is muxes[n]
+ * @param count number of channels, 1 to ADS1115_MAX_SCAN_CHANNELS
+ * @param alertPin gpio wired to ALERT/RDY or ADS1115_SCAN_NO_PIN
+ * @return true if the scan thread is running
+ */
+bool ADS1115::startScan(const uint16_t *muxes, int count, int alertPin) {
+    if (scanning) {
+        fprintf(stderr, "ADS1115 scan already running\n");
+        return false;
+    }
+    if (count < 1 || count > ADS1115_MAX_SCAN_CHANNELS) {
+        fprintf(stderr, "ADS1115 scan channel count (%d) out of range\n", count);
+        return false;
+    }
+
+    memcpy(scanMuxes, muxes, count * sizeof(muxes[0]));
+    memset(scanTable, 0, sizeof(scanTable));
+    scanCount = count;
+
+    if (alertPin != ADS1115_SCAN_NO_PIN) {
+        alert = new Navio::GpioEdgeEvents(alertPin);
+        if (!alert->open(Navio::Pin::GpioEdgeFalling)) {
+            fprintf(stderr, "Failed to use gpio %d as ADS1115 ALERT/RDY\n", alertPin);
+            delete alert;
+            alert = NULL;
+            return false;
+        }
+
+        /* A high threshold with the MSB set and a low threshold with the MSB
+           clear turn ALERT/RDY into an active low conversion ready output */
+        if (!I2Cdev::writeWord(address, ADS1115_RA_HI_THRESH, 0x8000) ||
+            !I2Cdev::writeWord(address, ADS1115_RA_LO_THRESH, 0x0000)) {
+            /* ALERT/RDY would never signal, wait out the conversion time instead */
+            fprintf(stderr, "Error while writing thresholds, ADS1115 scan falls back to timed polling\n");
+            delete alert;
+            alert = NULL;
+        } else {
+            config.comparator = ADS1115_COMP_MODE_HYSTERESIS;
+            config.polarity = ADS1115_COMP_POL_ACTIVE_LOW;
+            config.latch = ADS1115_COMP_LAT_NON_LATCHING;
+            config.queue = ADS1115_COMP_QUE_ASSERT1;
+        }
+    }
+
+    config.mux = scanMuxes[0];
+    if (scanCount == 1) {
+        config.mode = ADS1115_MODE_CONTINUOUS;
+        config.status = ADS1115_OS_INACTIVE;
+    } else {
+        config.mode = ADS1115_MODE_SINGLESHOT;
+        config.status = ADS1115_OS_ACTIVE;
+    }
+    updateConfigRegister();
+
+    scanning = true;
+    if (pthread_create(&scanThreadId, NULL, scanThread, this) != 0) {
+        fprintf(stderr, "Failed to start ADS1115 scan thread\n");
+        scanning = false;
+        delete alert;
+        alert = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Stop the scan thread and return to single-shot mode
+ */
+void ADS1115::stopScan() {
+    if (!scanning) {
+        return;
+    }
+    scanning = false;
+    pthread_join(scanThreadId, NULL);
+
+    delete alert;
+    alert = NULL;
+
+    config.queue = ADS1115_COMP_QUE_DISABLE;
+    config.status = ADS1115_OS_INACTIVE;
+    config.mode = ADS1115_MODE_SINGLESHOT;
+    updateConfigRegister();
+}
+
+bool ADS1115::isScanning() {
+    return scanning;
+}
+
+/**
+ * @brief Get the latest conversion of a scanned channel
+ * Safe to call from any thread, never blocks on the bus or the scan thread.
+ *
+ * @param channel index into the muxes given to startScan()
+ * @param sample latest raw value, its value in mV and its timestamp
+ * @return false if the channel is not scanned or has no conversion yet
+ */
+bool ADS1115::getScanSample(int channel, ADS1115Sample *sample) {
+    if (channel < 0 || channel >= scanCount) {
+        return false;
+    }
+
+    scanSlot &slot = scanTable[channel];
+    unsigned int seq;
+    do {
+        seq = slot.seq;
+        __sync_synchronize();
+        *sample = slot.sample;
+        __sync_synchronize();
+    } while ((seq & 1) || seq != slot.seq);
+
+    return sample->timestamp != 0;
+}
+
+uint64_t ADS1115::getTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Store a result for getScanSample(), the sequence counter is odd while it is written
+ */
+void ADS1115::publish(int channel, int16_t raw, uint64_t timestamp) {
+    scanSlot &slot = scanTable[channel];
+
+    slot.seq++;
+    __sync_synchronize();
+    slot.sample.raw = raw;
+    slot.sample.milliVolts = raw * getMilliVoltsPerBit();
+    slot.sample.timestamp = timestamp;
+    __sync_synchronize();
+    slot.seq++;
+}
+
+/**
+ * @brief Wait for the ALERT/RDY edge or until deadline if there is no pin.
+ * A missed edge is bounded by the deadline, the conversion is over by then.
+ * @return time of the edge, or of the return without one, in microseconds
+ */
+uint64_t ADS1115::waitConversion(uint64_t deadline) {
+    uint64_t now = getTimeUs();
+
+    if (alert != NULL) {
+        Navio::GpioEvent event;
+        int timeout = (deadline > now ? (deadline - now) / 1000 : 0) + 10;
+        int ret = alert->wait(&event, timeout);
+        if (ret > 0) {
+            return event.timestamp / 1000;
+        }
+        if (ret == 0) {
+            return getTimeUs();
+        }
+    }
+
+    if (deadline > now) {
+        struct timespec ts;
+        ts.tv_sec = deadline / 1000000;
+        ts.tv_nsec = (deadline % 1000000) * 1000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    return getTimeUs();
+}
+
+/**
+ * @brief Write the config register through the I2C scheduler, behind sensor
+ * and actuator traffic, and wait until it is on the bus
+ *
+ * @return True on success
+ */
+bool ADS1115::scanWriteConfig() {
+    uint16_t c = getConfigWord();
+    uint8_t data[2] = {static_cast<uint8_t>(c >> 8), static_cast<uint8_t>(c & 0xFF)};
+
+    scanResult.reset();
+    if (!I2Cscheduler::get().write(I2C_PRIORITY_LOW, address, ADS1115_RA_CONFIG, data, 2,
+                                   scanTransferDone, this)) {
+        fprintf(stderr, "Error while queueing config\n");
+        return false;
+    }
+    scanWait();
+
+    if (scanResult.status < 0) {
+        fprintf(stderr, "Error while writing config\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read the Conversion Register through the I2C scheduler
+ *
+ * @param raw conversion result
+ * @return True on success
+ */
+bool ADS1115::scanReadConversion(int16_t *raw) {
+    scanResult.reset();
+    if (!I2Cscheduler::get().read(I2C_PRIORITY_LOW, address, ADS1115_RA_CONVERSION, 2,
+                                  scanTransferDone, this)) {
+        fprintf(stderr, "Error while queueing read\n");
+        return false;
+    }
+    scanWait();
+
+    if (scanResult.status < 0) {
+        fprintf(stderr, "Error while reading\n");
+        return false;
+    }
+    *raw = (int16_t)(scanResult.data[0] << 8 | scanResult.data[1]);
+    return true;
+}
+
+void ADS1115::scanWait() {
+    while (sem_wait(&scanDone) != 0 && errno == EINTR) {
+    }
+}
+
+void ADS1115::scanTransferDone(void *arg, int status, const uint8_t *data, unsigned int length) {
+    ADS1115 *adc = (ADS1115 *)arg;
+    I2Cresult::complete(&adc->scanResult, status, data, length);
+    sem_post(&adc->scanDone);
+}
+
+void *ADS1115::scanThread(void *arg) {
+    ((ADS1115 *)arg)->scanLoop();
+    return NULL;
+}
+
+void ADS1115::scanLoop() {
+    unsigned int period = getConversionTimeUs();
+    uint64_t deadline = getTimeUs() + period;
+    int channel = 0;
+
+    while (scanning) {
+        uint64_t timestamp = waitConversion(deadline);
+
+        /* Read before the next conversion starts, however long other traffic
+           holds back the low priority requests */
+        int16_t raw;
+        if (scanReadConversion(&raw)) {
+            publish(channel, raw, timestamp);
+        }
+
+        if (scanCount > 1) {
+            /* config.status is still OS_ACTIVE, the write starts the next conversion */
+            channel = (channel + 1) % scanCount;
+            config.mux = scanMuxes[channel];
+            scanWriteConfig();
+            deadline = getTimeUs() + period;
+        } else {
+            deadline += period;
+            if (deadline < timestamp) {
+                deadline = timestamp + period;
+            }
+        }
+    }
+}
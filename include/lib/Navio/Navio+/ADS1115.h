@@ -109,12 +109,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ADS1115_COMP_LAT_LATCHING       0x01 << ADS1115_COMP_LAT_SHIFT
 
 #define ADS1115_COMP_QUE_SHIFT        0
-#define ADS1115_COMP_QUE_ASSERT1    0x00 << ADS1115_COMP_SHIFT
-#define ADS1115_COMP_QUE_ASSERT2    0x01 << ADS1115_COMP_SHIFT
-#define ADS1115_COMP_QUE_ASSERT4    0x02 << ADS1115_COMP_SHIFT
+#define ADS1115_COMP_QUE_ASSERT1    0x00 << ADS1115_COMP_QUE_SHIFT
+#define ADS1115_COMP_QUE_ASSERT2    0x01 << ADS1115_COMP_QUE_SHIFT
+#define ADS1115_COMP_QUE_ASSERT4    0x02 << ADS1115_COMP_QUE_SHIFT
 #define ADS1115_COMP_QUE_DISABLE    0x03 // default
 
+#define ADS1115_MAX_SCAN_CHANNELS   8       // one per multiplexer setting
+#define ADS1115_SCAN_NO_PIN         -1      // pace the scan by the data rate
+
+#include <pthread.h>
+#include <semaphore.h>
 #include <Common/I2Cdev.h>
+#include <Common/I2Cscheduler.h>
+#include <Common/gpio.h>
+
+struct ADS1115Sample {
+    int16_t raw;
+    float milliVolts;
+    uint64_t timestamp;             // us, CLOCK_MONOTONIC, 0 before the first conversion
+};
 
 class ADS1115 {
     public:
@@ -146,8 +159,27 @@ class ADS1115 {
         void setComparatorLatchEnabled(uint16_t latchStatus);
         void setComparatorQueueMode(uint16_t queueMode);
 
+        bool startScan(const uint16_t *muxes, int count, int alertPin = ADS1115_SCAN_NO_PIN);
+        void stopScan();
+        bool isScanning();
+        bool getScanSample(int channel, ADS1115Sample *sample);
+
     private:
+        uint16_t getConfigWord();
         void updateConfigRegister();
+        bool scanWriteConfig();
+        int16_t readConversion();
+        bool scanReadConversion(int16_t *raw);
+        void scanWait();
+        static void scanTransferDone(void *arg, int status, const uint8_t *data, unsigned int length);
+        float getMilliVoltsPerBit();
+        unsigned int getConversionTimeUs();
+
+        static uint64_t getTimeUs();
+        static void *scanThread(void *arg);
+        void scanLoop();
+        uint64_t waitConversion(uint64_t deadline);
+        void publish(int channel, int16_t raw, uint64_t timestamp);
 
         uint8_t address;
 
@@ -163,6 +195,20 @@ class ADS1115 {
             uint16_t queue;
         } config;
 
+        struct scanSlot {
+            volatile unsigned int seq;
+            ADS1115Sample sample;
+        };
+
+        uint16_t scanMuxes[ADS1115_MAX_SCAN_CHANNELS];
+        scanSlot scanTable[ADS1115_MAX_SCAN_CHANNELS];
+        int scanCount;
+        volatile bool scanning;
+        pthread_t scanThreadId;
+        Navio::GpioEdgeEvents *alert;
+        I2Cresult scanResult;
+        sem_t scanDone;
+
         void showConfigRegister();
 };
 
@@ -27,6 +27,7 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <errno.h>
 #include "MB85RC256.h"
 
 MB85RC256::MB85RC256(uint8_t address)
@@ -44,28 +45,65 @@ uint8_t MB85RC256::writeByte(uint16_t register_address, uint8_t data)
 	return MB85RC256::writeBytes(register_address, 1, &data);
 }
 
+/* Memory accesses are queued on the I2C scheduler at low priority, so that
+   logging never holds the bus ahead of actuator and sensor traffic. Longer
+   accesses are split into I2C_SCHED_MAX_DATA chunks, the caller sleeps
+   until each one is done. */
 uint8_t MB85RC256::writeBytes(uint16_t register_address, uint8_t length, uint8_t* data)
 {
-    uint8_t reg_address_low = register_address; // lower part of the address
-    uint8_t reg_address_high = register_address >> 8; // higher part of the address
-    uint8_t msg[length + 1];
+    for (int offset = 0; offset < length; offset += I2C_SCHED_MAX_DATA) {
+        int chunk = length - offset < I2C_SCHED_MAX_DATA ? length - offset : I2C_SCHED_MAX_DATA;
 
-    msg[0] = reg_address_low;
-
-    for (int i = 0; i < length; i++) {
-        msg[i + 1] = data[i];
+        if (transfer(false, register_address + offset, chunk, data + offset) < 0)
+            return false;
     }
-
-	return I2Cdev::writeBytes(this->device_address, reg_address_high, length + 1, msg);
+    return true;
 }
 
 uint8_t MB85RC256::readBytes(uint16_t register_address, uint8_t length, uint8_t* data)
 {
-    uint8_t reg_address_low = register_address; // lower part of the address
-    uint8_t reg_address_high = register_address >> 8; // higher part of the address
+    for (int offset = 0; offset < length; offset += I2C_SCHED_MAX_DATA) {
+        int chunk = length - offset < I2C_SCHED_MAX_DATA ? length - offset : I2C_SCHED_MAX_DATA;
+
+        if (transfer(true, register_address + offset, chunk, data + offset) < 0)
+            return -1;
+    }
+    return length;
+}
+
+/* Queues one chunk and waits for it, returns the scheduler status */
+int MB85RC256::transfer(bool is_read, uint16_t register_address, uint8_t length, uint8_t* data)
+{
+    Request request;
+    sem_init(&request.done, 0, 0);
 
-    I2Cdev::writeByte(this->device_address, reg_address_high, reg_address_low); // set the read pointer to the desired address
+    I2Cscheduler &scheduler = I2Cscheduler::get();
+    bool queued;
+    if (is_read)
+        queued = scheduler.read16(I2C_PRIORITY_LOW, device_address, register_address, length,
+                                  transferDone, &request);
+    else
+        queued = scheduler.write16(I2C_PRIORITY_LOW, device_address, register_address, data, length,
+                                   transferDone, &request);
 
-	return I2Cdev::readBytesNoRegAddress(this->device_address, length, data);
+    if (!queued) {
+        fprintf(stderr, "Failed to queue FRAM access\n");
+        sem_destroy(&request.done);
+        return -1;
+    }
+
+    while (sem_wait(&request.done) != 0 && errno == EINTR) {
+    }
+    sem_destroy(&request.done);
+
+    if (is_read && request.result.status > 0)
+        memcpy(data, request.result.data, length);
+    return request.result.status;
 }
 
+void MB85RC256::transferDone(void *arg, int status, const uint8_t *data, unsigned int length)
+{
+    Request *request = (Request *)arg;
+    I2Cresult::complete(&request->result, status, data, length);
+    sem_post(&request->done);
+}
@@ -35,12 +35,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <semaphore.h>
 #include <Common/I2Cdev.h>
+#include <Common/I2Cscheduler.h>
 
 class MB85RC256
 {
 	uint8_t device_address;
 
+	struct Request {
+		I2Cresult result;
+		sem_t done;
+	};
+
+	int transfer(bool is_read, uint16_t register_address, uint8_t length, uint8_t* data);
+	static void transferDone(void *arg, int status, const uint8_t *data, unsigned int length);
+
 public:
 	MB85RC256(uint8_t address = 0b1010000);
 	uint8_t readByte(uint16_t register_address, uint8_t* data);
@@ -111,7 +111,18 @@ void PCA9685::setFrequency(float frequency) {
  * @see PCA9685_RA_LED0_ON_L
  */
 void PCA9685::setPWM(uint8_t channel, uint16_t offset, uint16_t length) {
-    uint8_t data[4] = {0, 0, 0, 0};
+    uint8_t data[4];
+    encodePWM(data, offset, length);
+    I2Cdev::writeBytes(devAddr, PCA9685_RA_LED0_ON_L + 4 * channel, 4, data);
+}
+
+/** Fill the LEDn_ON_L..LEDn_OFF_H registers of one channel
+ * @param data 4 bytes
+ * @param Offset (0-4095)
+ * @param Length (0-4096), 0 is fully off and 4096 fully on
+ */
+void PCA9685::encodePWM(uint8_t *data, uint16_t offset, uint16_t length) {
+    memset(data, 0, 4);
     if(length == 0) {
         data[3] = 0x10;
     } else if(length >= 4096) {
@@ -122,7 +133,96 @@ void PCA9685::setPWM(uint8_t channel, uint16_t offset, uint16_t length) {
         data[2] = length & 0xFF;
         data[3] = length >> 8;
     }
-    I2Cdev::writeBytes(devAddr, PCA9685_RA_LED0_ON_L + 4 * channel, 4, data);
+}
+
+/** Set pulse lengths of consecutive channels in one I2C write.
+ * Relies on the register auto-increment enabled by initialize(). With the
+ * default MODE2 the outputs change together at the stop condition.
+ * @param First channel number (0-15)
+ * @param Number of channels
+ * @param Lengths (0-4095), one per channel
+ * @return True on success
+ * @see PCA9685_MODE1_AI_BIT
+ */
+bool PCA9685::setPWMBurst(uint8_t channel, uint8_t count, const uint16_t *lengths) {
+    uint8_t data[4 * PCA9685_CHANNELS];
+    if (!encodePWMBurst(data, channel, count, lengths))
+        return false;
+    return I2Cdev::writeBytes(devAddr, PCA9685_RA_LED0_ON_L + 4 * channel, 4 * count, data);
+}
+
+/** Set pulse lengths in milliseconds of consecutive channels in one I2C write
+ * @param First channel number (0-15)
+ * @param Number of channels
+ * @param Lengths in milliseconds, one per channel
+ * @return True on success
+ * @see setPWMBurst
+ */
+bool PCA9685::setPWMmSBurst(uint8_t channel, uint8_t count, const float *lengths_mS) {
+    uint16_t lengths[PCA9685_CHANNELS];
+    count = lengthsFromMS(lengths, count, lengths_mS);
+    return setPWMBurst(channel, count, lengths);
+}
+
+/** Queue the burst of setPWMBurst() at actuator priority on the shared I2C
+ * scheduler. Returns without waiting for the bus, the outputs change when
+ * the scheduler runs the write, ahead of queued sensor and ADC traffic.
+ * @param First channel number (0-15)
+ * @param Number of channels
+ * @param Lengths (0-4095), one per channel
+ * @return True if the write was queued
+ * @see I2Cscheduler
+ */
+bool PCA9685::queuePWMBurst(uint8_t channel, uint8_t count, const uint16_t *lengths) {
+    uint8_t data[4 * PCA9685_CHANNELS];
+    if (!encodePWMBurst(data, channel, count, lengths))
+        return false;
+    return I2Cscheduler::get().write(I2C_PRIORITY_HIGH, devAddr, PCA9685_RA_LED0_ON_L + 4 * channel,
+                                     data, 4 * count);
+}
+
+/** Queue pulse lengths in milliseconds of consecutive channels as one I2C write
+ * @param First channel number (0-15)
+ * @param Number of channels
+ * @param Lengths in milliseconds, one per channel
+ * @return True if the write was queued
+ * @see queuePWMBurst
+ */
+bool PCA9685::queuePWMmSBurst(uint8_t channel, uint8_t count, const float *lengths_mS) {
+    uint16_t lengths[PCA9685_CHANNELS];
+    count = lengthsFromMS(lengths, count, lengths_mS);
+    return queuePWMBurst(channel, count, lengths);
+}
+
+/** Fill the LED registers of consecutive channels
+ * @param data 4 bytes per channel
+ * @param First channel number (0-15)
+ * @param Number of channels
+ * @param Lengths (0-4095), one per channel
+ * @return False if the channels are out of range
+ */
+bool PCA9685::encodePWMBurst(uint8_t *data, uint8_t channel, uint8_t count, const uint16_t *lengths) {
+    if (channel + count > PCA9685_CHANNELS) {
+        fprintf(stderr, "PCA9685 channels %d-%d out of range\n", channel, channel + count - 1);
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++)
+        encodePWM(data + 4 * i, 0, lengths[i]);
+    return true;
+}
+
+/** Convert pulse lengths in milliseconds at the current frequency
+ * @param lengths converted lengths (0-4096)
+ * @param Number of channels
+ * @param Lengths in milliseconds
+ * @return Number of converted channels, at most PCA9685_CHANNELS
+ */
+uint8_t PCA9685::lengthsFromMS(uint16_t *lengths, uint8_t count, const float *lengths_mS) {
+    if (count > PCA9685_CHANNELS)
+        count = PCA9685_CHANNELS;
+    for (uint8_t i = 0; i < count; i++)
+        lengths[i] = round((lengths_mS[i] * 4096.f) / (1000.f / frequency));
+    return count;
 }
 
 /** Set channel's pulse length
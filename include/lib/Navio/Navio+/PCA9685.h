@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <math.h>
 #include <string>
 #include "../Common/I2Cdev.h"
+#include "../Common/I2Cscheduler.h"
 
 #define PCA9685_DEFAULT_ADDRESS     0x40 // All address pins low, Navio default
 
@@ -68,6 +69,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PCA9685_MODE2_OUTNE1_BIT    1
 #define PCA9685_MODE2_OUTNE0_BIT    0
 
+#define PCA9685_CHANNELS            16
+
 class PCA9685 {
     public:
         PCA9685(uint8_t address = PCA9685_DEFAULT_ADDRESS);
@@ -86,12 +89,21 @@ class PCA9685 {
         void setPWMmS(uint8_t channel, float length_mS);
         void setPWMuS(uint8_t channel, float length_uS);
 
+        bool setPWMBurst(uint8_t channel, uint8_t count, const uint16_t *lengths);
+        bool setPWMmSBurst(uint8_t channel, uint8_t count, const float *lengths_mS);
+        bool queuePWMBurst(uint8_t channel, uint8_t count, const uint16_t *lengths);
+        bool queuePWMmSBurst(uint8_t channel, uint8_t count, const float *lengths_mS);
+
         void setAllPWM(uint16_t offset, uint16_t length);
         void setAllPWM(uint16_t length);
         void setAllPWMmS(float length_mS);
         void setAllPWMuS(float length_uS);
 
      private:
+        static void encodePWM(uint8_t *data, uint16_t offset, uint16_t length);
+        static bool encodePWMBurst(uint8_t *data, uint8_t channel, uint8_t count, const uint16_t *lengths);
+        uint8_t lengthsFromMS(uint16_t *lengths, uint8_t count, const float *lengths_mS);
+
         uint8_t devAddr;
         float frequency;
 };
@@ -1,6 +1,9 @@
 #include "RCOutput_Navio.h"
 
-RCOutput_Navio::RCOutput_Navio()
+RCOutput_Navio::RCOutput_Navio() :
+    pwm_ready(false),
+    staged_mask(0),
+    commit_skew_us(-1)
 {
 }
 
@@ -18,12 +21,22 @@ bool RCOutput_Navio::initialize(int channel)
         return false;
     }
 
+    /* Pulse lengths are converted with the frequency read here, so that
+       duty cycles can be set before enable() */
+    if (!pwm_ready) {
+        pwm.initialize();
+        pwm_ready = true;
+    }
+
     return true;
 }
 
 bool RCOutput_Navio::enable(int channel)
 {
-    pwm.initialize();
+    if (!pwm_ready) {
+        pwm.initialize();
+        pwm_ready = true;
+    }
     return true;
 }
 
@@ -35,6 +48,52 @@ bool RCOutput_Navio::set_frequency(int channel, float frequency)
 
 bool RCOutput_Navio::set_duty_cycle(int channel, float period)
 {
-    pwm.setPWMmS(channel+3, period / 1000); // 1st Navio RC output is 3
+    pwm.setPWMmS(channel + CHANNEL_OFFSET, period / 1000);
+    return true;
+}
+
+bool RCOutput_Navio::stage_duty_cycle(int channel, float period)
+{
+    if (channel < 0 || channel >= CHANNEL_COUNT) {
+        fprintf(stderr, "Can't set duty cycle to channel %d\n", channel);
+        return false;
+    }
+    staged_ms[channel] = period / 1000;
+    staged_mask |= 1u << channel;
     return true;
 }
+
+/* Every run of consecutive staged channels goes out as one auto-increment
+   burst, the outputs of a burst change together at its stop condition.
+   The bursts are queued at actuator priority on the I2C scheduler, the
+   control loop does not wait for the bus or behind barometer and ADC reads */
+bool RCOutput_Navio::commit()
+{
+    bool ok = true;
+    int bursts = 0;
+    int channel = 0;
+
+    while (staged_mask != 0) {
+        while (!(staged_mask & (1u << channel)))
+            channel++;
+
+        int count = 0;
+        while (channel + count < CHANNEL_COUNT && (staged_mask & (1u << (channel + count)))) {
+            staged_mask &= ~(1u << (channel + count));
+            count++;
+        }
+
+        ok &= pwm.queuePWMmSBurst(channel + CHANNEL_OFFSET, count, staged_ms + channel);
+        bursts++;
+        channel += count;
+    }
+
+    // Channels of separate bursts are not measured
+    commit_skew_us = bursts <= 1 ? 0 : -1;
+    return ok;
+}
+
+int RCOutput_Navio::get_commit_skew_us()
+{
+    return commit_skew_us;
+}
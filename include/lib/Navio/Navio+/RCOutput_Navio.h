@@ -16,9 +16,19 @@ public:
     bool enable(int channel) override;
     bool set_frequency(int channel, float frequency) override;
     bool set_duty_cycle(int channel, float period) override;
+    bool stage_duty_cycle(int channel, float period) override;
+    bool commit() override;
+    int get_commit_skew_us() override;
 
 private:
+    static const int CHANNEL_OFFSET = 3; // 1st Navio RC output is 3
+    static const int CHANNEL_COUNT = PCA9685_CHANNELS - CHANNEL_OFFSET;
+
     PCA9685 pwm;
+    bool pwm_ready;
+    float staged_ms[CHANNEL_COUNT];
+    uint32_t staged_mask;
+    int commit_skew_us;
 };
 
 #endif // RCOUTPUT_NAVIO_H
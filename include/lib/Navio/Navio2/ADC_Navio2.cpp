@@ -1,11 +1,9 @@
 #include <cstdio>
-#include <unistd.h>
-#include <fcntl.h>
-#include <cstdlib>
-#include <err.h>
+#include <cstring>
 
 #include "ADC_Navio2.h"
 #include <Common/Util.h>
+#include "RCIOSampler.h"
 
 #define ADC_SYSFS_PATH "/sys/kernel/rcio/adc"
 
@@ -21,11 +19,15 @@ ADC_Navio2::~ADC_Navio2()
 void ADC_Navio2::initialize()
 {
     for (size_t i = 0; i < ARRAY_SIZE(channels); i++) {
-        channels[i] = open_channel(i);
-        if (channels[i] < 0) {
-            perror("open");
+        if (!open_channel(i)) {
+            fprintf(stderr, "open: %s\n", strerror(-channels[i].last_error()));
         }
     }
+
+    /* All channels are read in the background, unless RCIOSampler::get()
+       was started before with another rate */
+    if (!RCIOSampler::get().start())
+        fprintf(stderr, "RCIO sampler not started, reads go to sysfs\n");
 }
 
 int ADC_Navio2::get_channel_count(void)
@@ -35,31 +37,23 @@ int ADC_Navio2::get_channel_count(void)
 
 int ADC_Navio2::read(int ch)
 {
-    if (ch > ARRAY_SIZE(channels) )
-	{
+    if (ch < 0 || ch >= (int)ARRAY_SIZE(channels))
+    {
         fprintf(stderr,"Channel number too large\n");
         return -1;
-	}
-    char buffer[10];
-
-    if (::pread(channels[ch], buffer, ARRAY_SIZE(buffer), 0) < 0) {
-        perror("pread");
     }
 
-    return atoi(buffer);
+    RCIOSampler &sampler = RCIOSampler::get();
+    if (sampler.is_running())
+        return sampler.read_adc(ch);
+
+    return RCIOSampler::read_channel(channels[ch]);
 }
 
-int ADC_Navio2::open_channel(int channel)
+bool ADC_Navio2::open_channel(int channel)
 {
-    char *channel_path;
-    if (asprintf(&channel_path, "%s/ch%d", ADC_SYSFS_PATH, channel) == -1) {
-        err(1, "adc channel: %d\n", channel);
-    }
+    char channel_path[64];
+    snprintf(channel_path, sizeof(channel_path), "%s/ch%d", ADC_SYSFS_PATH, channel);
 
-    int fd = ::open(channel_path, O_RDONLY);
-
-    free(channel_path);
-
-    return fd;
+    return channels[channel].open(channel_path) == 0;
 }
-
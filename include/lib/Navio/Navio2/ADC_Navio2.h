@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <Common/SysfsAttr.h>
 #include <Common/ADC.h>
 
 class ADC_Navio2 : public ADC
@@ -13,8 +14,8 @@ public:
     ~ADC_Navio2();
 
 private:
-    int open_channel(int ch);
+    bool open_channel(int ch);
 
     static const size_t CHANNEL_COUNT = 6;
-    int channels[CHANNEL_COUNT];
+    SysfsAttr channels[CHANNEL_COUNT];
 };
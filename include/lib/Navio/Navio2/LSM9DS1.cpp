@@ -2,19 +2,30 @@
   Written by Alexey Bulatov (alexey.bulatov@emlid.com) for Raspberry Pi
 */
 
+#include <string.h>
 #include "LSM9DS1.h"
 
 #define DEVICE_ACC_GYRO     "/dev/spidev0.3"
 #define DEVICE_MAGNETOMETER "/dev/spidev0.2"
 
+#define SPI_SLOW_HZ         1000000
+#define SPI_FAST_HZ         10000000
+
 #define READ_FLAG     0x80
 #define MULTIPLE_READ 0x40
 
 #define G_SI          9.80665
 #define PI            3.14159
 
-LSM9DS1::LSM9DS1()
+LSM9DS1::LSM9DS1() :
+    acc_gyro_spi(DEVICE_ACC_GYRO, SPI_SLOW_HZ, SPI_FAST_HZ),
+    mag_spi(DEVICE_MAGNETOMETER, SPI_SLOW_HZ, SPI_FAST_HZ),
+    fifo_enabled(false),
+    sample_rate_hz(952),
+    next_temp_us(0),
+    next_mag_us(0)
 {
+    memset(slow_data, 0, sizeof(slow_data));
 }
 
 /*-----------------------------------------------------------------------------------------------
@@ -22,28 +33,28 @@ LSM9DS1::LSM9DS1()
 usage: use these methods to read and write LSM9DS1 registers over SPI
 -----------------------------------------------------------------------------------------------*/
 
-unsigned int LSM9DS1::WriteReg(const char *dev, uint8_t WriteAddr, uint8_t WriteData )
+unsigned int LSM9DS1::WriteReg(SPIdev &dev, uint8_t WriteAddr, uint8_t WriteData )
 {
     unsigned char tx[2] = {WriteAddr, WriteData};
     unsigned char rx[2] = {0};
-    SPIdev::transfer(dev, tx, rx, 2);
+    dev.transfer(tx, rx, 2);
     return rx[1];
 }
 
-unsigned int  LSM9DS1::ReadReg(const char *dev, uint8_t ReadAddr)
+unsigned int  LSM9DS1::ReadReg(SPIdev &dev, uint8_t ReadAddr)
 {
     return WriteReg(dev, ReadAddr | READ_FLAG, 0x00);
 }
 
-void LSM9DS1::ReadRegs(const char *dev, uint8_t ReadAddr, uint8_t *ReadBuf, unsigned int Bytes )
+void LSM9DS1::ReadRegs(SPIdev &dev, uint8_t ReadAddr, uint8_t *ReadBuf, unsigned int Bytes )
 {
     unsigned char tx[255] = {0};
     unsigned char rx[255] = {0};
 
     tx[0] = ReadAddr | READ_FLAG;
-    if (!strcmp(dev, DEVICE_MAGNETOMETER)) tx[0] |= MULTIPLE_READ;
+    if (&dev == &mag_spi) tx[0] |= MULTIPLE_READ;
 
-    SPIdev::transfer(dev, tx, rx, Bytes + 1);
+    dev.transfer(tx, rx, Bytes + 1, dev.getBurstSpeed());
 
     for (uint i = 0; i < Bytes; i++)
         ReadBuf[i] = rx[i + 1];
@@ -60,8 +71,8 @@ returns true if Accel/Gyro and Magnetometer answers
 bool LSM9DS1::probe()
 {
     uint8_t responseXG,responseM;
-    responseXG = ReadReg(DEVICE_ACC_GYRO, LSM9DS1XG_WHO_AM_I);
-    responseM = ReadReg(DEVICE_MAGNETOMETER, LSM9DS1M_WHO_AM_I);
+    responseXG = ReadReg(acc_gyro_spi, LSM9DS1XG_WHO_AM_I);
+    responseM = ReadReg(mag_spi, LSM9DS1M_WHO_AM_I);
     if (responseXG == WHO_AM_I_ACC_GYRO && responseM == WHO_AM_I_MAG)
         return true;
     else
@@ -72,32 +83,32 @@ bool LSM9DS1::initialize()
 {
     //--------Accelerometer and Gyroscope---------
     // enable the 3-axes of the gyroscope
-    WriteReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG4, BITS_XEN_G |
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG4, BITS_XEN_G |
                                                 BITS_YEN_G |
                                                 BITS_ZEN_G);
     // configure the gyroscope
-    WriteReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG1_G, BITS_ODR_G_952HZ |
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G, BITS_ODR_G_952HZ |
                                                   BITS_FS_G_2000DPS);
     usleep(200);
 
     // enable the three axes of the accelerometer
-    WriteReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG5_XL, BITS_XEN_XL |
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG5_XL, BITS_XEN_XL |
                                                    BITS_YEN_XL |
                                                    BITS_ZEN_XL);
     // configure the accelerometer-specify bandwidth selection with Abw
-    WriteReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG6_XL, BITS_ODR_XL_952HZ |
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG6_XL, BITS_ODR_XL_952HZ |
                                                    BITS_FS_XL_16G);
     usleep(200);
 
     //------------Magnetometer----------------
-    WriteReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG1_M, BITS_TEMP_COMP |
+    WriteReg(mag_spi, LSM9DS1M_CTRL_REG1_M, BITS_TEMP_COMP |
                                             BITS_OM_HIGH |
                                             BITS_ODR_M_80HZ);
-    WriteReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG2_M, BITS_FS_M_16Gs);
+    WriteReg(mag_spi, LSM9DS1M_CTRL_REG2_M, BITS_FS_M_16Gs);
     // continuous conversion mode
-    WriteReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG3_M, BITS_MD_CONTINUOUS);
-    WriteReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG4_M, BITS_OMZ_HIGH);
-    WriteReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG5_M, 0x00 );
+    WriteReg(mag_spi, LSM9DS1M_CTRL_REG3_M, BITS_MD_CONTINUOUS);
+    WriteReg(mag_spi, LSM9DS1M_CTRL_REG4_M, BITS_OMZ_HIGH);
+    WriteReg(mag_spi, LSM9DS1M_CTRL_REG5_M, 0x00 );
     usleep(200);
 
     set_gyro_scale(BITS_FS_G_2000DPS);
@@ -108,65 +119,355 @@ bool LSM9DS1::initialize()
 
 void LSM9DS1::update()
 {
-    uint8_t response[6];
-    int16_t bit_data[3];
+    InertialRawSample raw[LSM9DS1_FIFO_DEPTH];
 
-    // Read temperature
-    ReadRegs(DEVICE_ACC_GYRO, LSM9DS1XG_OUT_TEMP_L, &response[0], 2);
-    temperature = (float)(((int16_t)response[1] << 8) | response[0]) / 256. + 25.;
+    // In FIFO mode the output registers pop the FIFO, drain it and keep the latest frame
+    int frames = update_raw_batch(raw, LSM9DS1_FIFO_DEPTH);
+    if (frames > 0)
+        apply_raw(raw[frames - 1].data);
+}
 
-    // Read accelerometer
-    ReadRegs(DEVICE_ACC_GYRO, LSM9DS1XG_OUT_X_L_XL, &response[0], 6);
-    for (int i=0; i<3; i++) {
-        bit_data[i] = ((int16_t)response[2*i+1] << 8) | response[2*i] ;
+int LSM9DS1::update_batch(InertialSample *samples, int max_samples)
+{
+    InertialRawSample raw[LSM9DS1_FIFO_DEPTH];
+
+    if (max_samples > LSM9DS1_FIFO_DEPTH)
+        max_samples = LSM9DS1_FIFO_DEPTH;
+
+    int frames = update_raw_batch(raw, max_samples);
+
+    for (int n = 0; n < frames; n++) {
+        apply_raw(raw[n].data);
+        read_sample(&samples[n]);
+        samples[n].timestamp = raw[n].timestamp;
+        samples[n].mag_new = raw[n].mag_new;
+    }
+
+    return frames;
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    SAMPLE READ
+usage: call this function periodically. Without FIFO mode temperature, gyroscope and
+accelerometer are read in one auto-increment burst, the control registers in between are
+skipped. In FIFO mode all frames queued since the last call are read in one SPI message and
+stored oldest first, with timestamps spread back from the read time, temperature is read at
+LSM9DS1_TEMP_PERIOD_US. The magnetometer is read at its own output data rate in both modes.
+returns the number of samples stored
+-----------------------------------------------------------------------------------------------*/
+
+int LSM9DS1::update_raw_batch(InertialRawSample *samples, int max_samples)
+{
+    if (max_samples < 1)
+        return 0;
+
+    uint64_t now = get_timestamp_us();
+    read_mag(now);
+
+    SPItransaction transaction(acc_gyro_spi);
+
+    if (!fifo_enabled) {
+        uint8_t response[LSM9DS1XG_OUT_Z_H_XL - LSM9DS1XG_OUT_TEMP_L + 1];
+
+        transaction.read(LSM9DS1XG_OUT_TEMP_L | READ_FLAG, response, sizeof(response));
+        if (transaction.submit() < 0)
+            return 0;
+
+        slow_data[INERTIAL_RAW_TEMP] = ((int16_t)response[1] << 8) | response[0];
+        memcpy(samples[0].data, slow_data, sizeof(slow_data));
+        decode_axes(&response[LSM9DS1XG_OUT_X_L_XL - LSM9DS1XG_OUT_TEMP_L], &samples[0].data[0]);
+        decode_axes(&response[LSM9DS1XG_OUT_X_L_G - LSM9DS1XG_OUT_TEMP_L], &samples[0].data[3]);
+        samples[0].timestamp = take_sample_timestamp();
+        samples[0].mag_new = _mag_new;
+        return 1;
+    }
+
+    uint8_t fifo_src = 0;
+    uint8_t temp[2];
+    bool read_temp = now >= next_temp_us;
+
+    transaction.read(LSM9DS1XG_FIFO_SRC | READ_FLAG, &fifo_src, 1);
+    if (read_temp)
+        transaction.read(LSM9DS1XG_OUT_TEMP_L | READ_FLAG, temp, 2);
+    if (transaction.submit() < 0)
+        return 0;
+
+    if (read_temp) {
+        slow_data[INERTIAL_RAW_TEMP] = ((int16_t)temp[1] << 8) | temp[0];
+        next_temp_us = now + LSM9DS1_TEMP_PERIOD_US;
     }
-    _ax = G_SI * ((float)bit_data[0] * acc_scale);
-    _ay = G_SI * ((float)bit_data[1] * acc_scale);
-    _az = G_SI * ((float)bit_data[2] * acc_scale);
 
-    // Read gyroscope
-    ReadRegs(DEVICE_ACC_GYRO, LSM9DS1XG_OUT_X_L_G, &response[0], 6);
+    // Continuous mode overwrites the oldest frames on overrun, nothing to recover
+    int frames = fifo_src & BITS_FSS_MASK;
+    if (frames > max_samples)
+        frames = max_samples;
+    if (frames > LSM9DS1_FIFO_DEPTH)
+        frames = LSM9DS1_FIFO_DEPTH;
+
+    // Each frame pops once both its gyroscope and accelerometer registers are read
+    uint8_t response[LSM9DS1_FIFO_DEPTH][12];
+    for (int n = 0; n < frames; n++) {
+        transaction.read(LSM9DS1XG_OUT_X_L_G | READ_FLAG, &response[n][0], 6);
+        transaction.read(LSM9DS1XG_OUT_X_L_XL | READ_FLAG, &response[n][6], 6);
+    }
+    if (frames > 0 && transaction.submit() < 0)
+        frames = 0;
+
+    float period_us = 1000000.0 / sample_rate_hz;
+    for (int n = 0; n < frames; n++) {
+        memcpy(samples[n].data, slow_data, sizeof(slow_data));
+        decode_axes(&response[n][6], &samples[n].data[0]);
+        decode_axes(&response[n][0], &samples[n].data[3]);
+        samples[n].timestamp = now - (uint64_t)((frames - 1 - n) * period_us);
+        // A new magnetometer reading is reported once, with the latest frame
+        samples[n].mag_new = _mag_new && n == frames - 1;
+    }
+
+    return frames;
+}
+
+void LSM9DS1::get_raw_scale(float scale[INERTIAL_RAW_TEMP])
+{
+    for (int i = 0; i < 3; i++) {
+        scale[i] = G_SI * acc_scale;
+        scale[i + 3] = (PI / 180) * gyro_scale;
+        scale[i + 6] = 100.0 * mag_scale;
+    }
+}
+
+void LSM9DS1::decode_axes(const uint8_t *response, int16_t *data)
+{
+    int16_t bit_data[3];
+
     for (int i=0; i<3; i++) {
         bit_data[i] = ((int16_t)response[2*i+1] << 8) | response[2*i] ;
     }
-    _gx = (PI / 180) * ((float)bit_data[0] * gyro_scale);
-    _gy = (PI / 180) * ((float)bit_data[1] * gyro_scale);
-    _gz = (PI / 180) * ((float)bit_data[2] * gyro_scale);
+    // Change rotation of LSM9DS1 like in MPU-9250
+    data[0] = -bit_data[1];
+    data[1] = -bit_data[0];
+    data[2] = bit_data[2];
+}
+
+void LSM9DS1::read_mag(uint64_t now)
+{
+    uint8_t response[7];
+    int16_t bit_data[3];
+
+    _mag_new = false;
+    if (now < next_mag_us)
+        return;
+
+    // Status and output registers in one burst
+    SPItransaction transaction(mag_spi);
+    transaction.read(LSM9DS1M_STATUS_REG_M | READ_FLAG | MULTIPLE_READ, response, sizeof(response));
+    if (transaction.submit() < 0 || !(response[0] & BIT_ZYXDA_M))
+        return;
 
-    // Read magnetometer
-    ReadRegs(DEVICE_MAGNETOMETER, LSM9DS1M_OUT_X_L_M, &response[0], 6);
     for (int i=0; i<3; i++) {
-        bit_data[i] = ((int16_t)response[2*i+1] << 8) | response[2*i] ;
+        bit_data[i] = ((int16_t)response[2*i+2] << 8) | response[2*i+1] ;
     }
-    _mx = 100.0 * ((float)bit_data[0] * mag_scale);
-    _my = 100.0 * ((float)bit_data[1] * mag_scale);
-    _mz = 100.0 * ((float)bit_data[2] * mag_scale);
+    slow_data[6] = bit_data[0];
+    slow_data[7] = -bit_data[1];
+    slow_data[8] = -bit_data[2];
 
-    // Change rotation of LSM9DS1 like in MPU-9250
-    rotate();
+    _mag_new = true;
+    _mag_timestamp = now;
+    next_mag_us = now + LSM9DS1_MAG_PERIOD_US;
 }
 
-void LSM9DS1::rotate()
+void LSM9DS1::apply_raw(const int16_t *data)
 {
-    float replacement_acc, replacement_gyro;
+    temperature = (float)data[INERTIAL_RAW_TEMP] / 256. + 25.;
+
+    _ax = G_SI * ((float)data[0] * acc_scale);
+    _ay = G_SI * ((float)data[1] * acc_scale);
+    _az = G_SI * ((float)data[2] * acc_scale);
+
+    _gx = (PI / 180) * ((float)data[3] * gyro_scale);
+    _gy = (PI / 180) * ((float)data[4] * gyro_scale);
+    _gz = (PI / 180) * ((float)data[5] * gyro_scale);
 
-    replacement_acc = _ax;
-    _ax = -_ay;
-    _ay = -replacement_acc;
+    _mx = 100.0 * ((float)data[6] * mag_scale);
+    _my = 100.0 * ((float)data[7] * mag_scale);
+    _mz = 100.0 * ((float)data[8] * mag_scale);
+}
 
-    replacement_gyro = _gx;
-    _gx = -_gy;
-    _gy = -replacement_gyro;
+/*-----------------------------------------------------------------------------------------------
+                                    FIFO MODE
+usage: call this function after initialize() to queue gyroscope and accelerometer frames in the
+32 frame FIFO at the output data rate chosen for rate_hz. The FIFO runs in continuous mode, so
+the oldest frames are dropped if it is not drained in time.
+returns true if FIFO mode was enabled
+-----------------------------------------------------------------------------------------------*/
 
-    _my = -_my;
-    _mz = -_mz;
+bool LSM9DS1::enable_fifo(unsigned int rate_hz)
+{
+    if (rate_hz == 0)
+        return false;
+
+    set_sample_rate(rate_hz);
+
+    uint8_t reg = ReadReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG9);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG9, reg | LSM9DS1_BIT_FIFO_EN);
+    // Going through bypass mode empties the FIFO
+    WriteReg(acc_gyro_spi, LSM9DS1XG_FIFO_CTRL, BITS_FMODE_BYPASS);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_FIFO_CTRL, BITS_FMODE_CONTINUOUS | 1);
+
+    fifo_enabled = true;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    DATA READY
+usage: raise INT1_A/G, wired to gpio pin, whenever new samples are available at rate_hz. Without
+FIFO mode the gyroscope output data rate is set to the lowest supported rate that is not below
+rate_hz and the pin follows the gyroscope data ready. In FIFO mode the output data rate is kept
+and the pin follows the FIFO watermark, set to the number of frames queued per 1/rate_hz.
+returns true if the gpio edge could be set up
+-----------------------------------------------------------------------------------------------*/
+
+bool LSM9DS1::enable_data_ready(uint8_t pin, unsigned int rate_hz)
+{
+    if (rate_hz == 0)
+        return false;
+
+    if (fifo_enabled) {
+        int watermark = (int)(sample_rate_hz / rate_hz + 0.5);
+        if (watermark < 1)
+            watermark = 1;
+        if (watermark > BITS_FTH_MASK)
+            watermark = BITS_FTH_MASK;
+
+        WriteReg(acc_gyro_spi, LSM9DS1XG_FIFO_CTRL, BITS_FMODE_CONTINUOUS | watermark);
+        WriteReg(acc_gyro_spi, LSM9DS1XG_INT1_CTRL, BIT_INT1_FTH);
+    } else {
+        set_sample_rate(rate_hz);
+        WriteReg(acc_gyro_spi, LSM9DS1XG_INT1_CTRL, BIT_INT1_DRDY_G);
+    }
+
+    return attach_data_ready(pin);
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    SAMPLE RATE
+usage: sets the gyroscope output data rate to the lowest supported rate that is not below
+rate_hz, the accelerometer follows the gyroscope rate
+returns the output data rate set in Hz
+-----------------------------------------------------------------------------------------------*/
+
+float LSM9DS1::set_sample_rate(unsigned int rate_hz)
+{
+    uint8_t odr;
+    float rate;
+
+    // the accelerometer follows the gyroscope rate
+    if (rate_hz <= 15) {
+        odr = BITS_ODR_G_14900mHZ; rate = 14.9;
+    } else if (rate_hz <= 60) {
+        odr = BITS_ODR_G_59500mHZ; rate = 59.5;
+    } else if (rate_hz <= 119) {
+        odr = BITS_ODR_G_119HZ; rate = 119;
+    } else if (rate_hz <= 238) {
+        odr = BITS_ODR_G_238HZ; rate = 238;
+    } else if (rate_hz <= 476) {
+        odr = BITS_ODR_G_476HZ; rate = 476;
+    } else {
+        odr = BITS_ODR_G_952HZ; rate = 952;
+    }
+
+    uint8_t reg = ~BITS_ODR_G_MASK & ReadReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G, reg | odr);
+
+    sample_rate_hz = rate;
+    return rate;
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    LOW PASS FILTER
+usage: selects the widest accelerometer (408, 211, 105 or 50 Hz) and gyroscope bandwidth that is
+not above bandwidth_hz. The gyroscope cutoffs depend on the output data rate, so call this
+function after set_sample_rate(). Rates below 119 Hz use the 119 Hz cutoffs as an estimate.
+returns the gyroscope bandwidth set in Hz
+-----------------------------------------------------------------------------------------------*/
+
+unsigned int LSM9DS1::set_lowpass(unsigned int bandwidth_hz)
+{
+    // Gyroscope cutoff of BW_G 0 to 3 at 119, 238, 476 and 952 Hz output data rate
+    static const unsigned int gyro_cutoff[4][4] = {{14, 31, 31, 31},
+                                                   {14, 29, 63, 78},
+                                                   {21, 28, 57, 100},
+                                                   {33, 40, 58, 100}};
+    static const unsigned int accel_cutoff[4] = {408, 211, 105, 50};
+    int odr, bw_g, bw_xl;
+
+    if (sample_rate_hz >= 952)
+        odr = 3;
+    else if (sample_rate_hz >= 476)
+        odr = 2;
+    else if (sample_rate_hz >= 238)
+        odr = 1;
+    else
+        odr = 0;
+
+    for (bw_g = 3; bw_g > 0; bw_g--) {
+        if (gyro_cutoff[odr][bw_g] <= bandwidth_hz)
+            break;
+    }
+    for (bw_xl = 0; bw_xl < 3; bw_xl++) {
+        if (accel_cutoff[bw_xl] <= bandwidth_hz)
+            break;
+    }
+
+    uint8_t reg = ~BITS_BW_G_MASK & ReadReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G, reg | bw_g);
+
+    reg = ~BITS_BW_XL_MASK & ReadReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG6_XL);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG6_XL, reg | BIT_BW_SCAL_ODR | bw_xl);
+
+    return gyro_cutoff[odr][bw_g];
+}
+
+/*-----------------------------------------------------------------------------------------------
+                                    FULL SCALE RANGE
+usage: select the smallest accelerometer (2, 4, 8 or 16 g) or gyroscope (245, 500 or 2000 dps)
+range that covers the requested range
+returns the range set
+-----------------------------------------------------------------------------------------------*/
+
+unsigned int LSM9DS1::set_accel_range(unsigned int range_g)
+{
+    if (range_g <= 2) {
+        set_acc_scale(BITS_FS_XL_2G);
+        return 2;
+    } else if (range_g <= 4) {
+        set_acc_scale(BITS_FS_XL_4G);
+        return 4;
+    } else if (range_g <= 8) {
+        set_acc_scale(BITS_FS_XL_8G);
+        return 8;
+    }
+    set_acc_scale(BITS_FS_XL_16G);
+    return 16;
+}
+
+unsigned int LSM9DS1::set_gyro_range(unsigned int range_dps)
+{
+    if (range_dps <= 245) {
+        set_gyro_scale(BITS_FS_G_245DPS);
+        return 245;
+    } else if (range_dps <= 500) {
+        set_gyro_scale(BITS_FS_G_500DPS);
+        return 500;
+    }
+    set_gyro_scale(BITS_FS_G_2000DPS);
+    return 2000;
 }
 
 void LSM9DS1::set_gyro_scale(int scale)
 {
     uint8_t reg;
-    reg = BITS_FS_G_MASK & ReadReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG1_G);
-    WriteReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG1_G,reg | scale);
+    reg = BITS_FS_G_MASK & ReadReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG1_G,reg | scale);
     switch (scale) {
     case BITS_FS_G_245DPS:
         gyro_scale = 0.00875;
@@ -183,8 +484,8 @@ void LSM9DS1::set_gyro_scale(int scale)
 void LSM9DS1::set_acc_scale(int scale)
 {
     uint8_t reg;
-    reg = BITS_FS_XL_MASK & ReadReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG6_XL);
-    WriteReg(DEVICE_ACC_GYRO, LSM9DS1XG_CTRL_REG6_XL, reg | scale);
+    reg = BITS_FS_XL_MASK & ReadReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG6_XL);
+    WriteReg(acc_gyro_spi, LSM9DS1XG_CTRL_REG6_XL, reg | scale);
     switch (scale) {
     case BITS_FS_XL_2G:
         acc_scale = 0.000061;
@@ -204,8 +505,8 @@ void LSM9DS1::set_acc_scale(int scale)
 void LSM9DS1::set_mag_scale(int scale)
 {
     uint8_t reg;
-    reg = BITS_FS_M_MASK & ReadReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG2_M);
-    WriteReg(DEVICE_MAGNETOMETER, LSM9DS1M_CTRL_REG2_M, reg | scale);
+    reg = BITS_FS_M_MASK & ReadReg(mag_spi, LSM9DS1M_CTRL_REG2_M);
+    WriteReg(mag_spi, LSM9DS1M_CTRL_REG2_M, reg | scale);
     switch (scale) {
     case BITS_FS_M_4Gs:
         mag_scale = 0.00014;
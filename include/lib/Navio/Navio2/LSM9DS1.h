@@ -9,6 +9,10 @@
 #include <Common/SPIdev.h>
 #include <Common/InertialSensor.h>
 
+#define LSM9DS1_FIFO_DEPTH      32          // gyroscope + accelerometer frames
+#define LSM9DS1_TEMP_PERIOD_US  100000      // temperature is read at 10 Hz
+#define LSM9DS1_MAG_PERIOD_US   12500       // magnetometer output data rate is 80 Hz
+
 class LSM9DS1 : public InertialSensor
 {
 public:
@@ -18,20 +22,43 @@ public:
     bool probe();
     void update();
 
+    bool enable_fifo(unsigned int rate_hz);
+    bool enable_data_ready(uint8_t pin, unsigned int rate_hz);
+    int update_batch(InertialSample *samples, int max_samples);
+    int update_raw_batch(InertialRawSample *samples, int max_samples);
+    void get_raw_scale(float scale[INERTIAL_RAW_TEMP]);
+
+    float set_sample_rate(unsigned int rate_hz);
+    unsigned int set_lowpass(unsigned int bandwidth_hz);
+    unsigned int set_accel_range(unsigned int range_g);
+    unsigned int set_gyro_range(unsigned int range_dps);
+
 private:
-    unsigned int WriteReg(const char *dev, uint8_t WriteAddr, uint8_t WriteData);
-    unsigned int ReadReg(const char *dev, uint8_t ReadAddr);
-    void ReadRegs(const char *dev, uint8_t ReadAddr, uint8_t *ReadBuf, unsigned int Bytes);
+    unsigned int WriteReg(SPIdev &dev, uint8_t WriteAddr, uint8_t WriteData);
+    unsigned int ReadReg(SPIdev &dev, uint8_t ReadAddr);
+    void ReadRegs(SPIdev &dev, uint8_t ReadAddr, uint8_t *ReadBuf, unsigned int Bytes);
 
     void set_gyro_scale(int scale);
     void set_acc_scale(int scale);
     void set_mag_scale(int scale);
 
-    void rotate();
+    void decode_axes(const uint8_t *response, int16_t *data);
+    void read_mag(uint64_t now);
+    void apply_raw(const int16_t *data);
 
     float gyro_scale;
     float acc_scale;
     float mag_scale;
+
+    SPIdev acc_gyro_spi;
+    SPIdev mag_spi;
+
+    bool fifo_enabled;
+    float sample_rate_hz;
+    // latest values of the channels read at their own rate
+    int16_t slow_data[INERTIAL_RAW_CHANNELS];
+    uint64_t next_temp_us;
+    uint64_t next_mag_us;
 };
 
 #endif //_LSM9DS1_H
@@ -129,22 +156,36 @@ private:
 #define BITS_ODR_G_238HZ            0x80
 #define BITS_ODR_G_476HZ            0xA0
 #define BITS_ODR_G_952HZ            0xC0
+#define BITS_ODR_G_MASK             0xE0
 #define BITS_ODR_XL_10HZ            0x20
 #define BITS_ODR_XL_50HZ            0x40
 #define BITS_ODR_XL_119HZ           0x60
 #define BITS_ODR_XL_238HZ           0x80
 #define BITS_ODR_XL_476HZ           0xA0
 #define BITS_ODR_XL_952HZ           0xC0
+#define BITS_BW_G_MASK              0x03
 #define BITS_FS_G_MASK              0xE3
 #define BITS_FS_G_245DPS            0x00
 #define BITS_FS_G_500DPS            0x08
 #define BITS_FS_G_2000DPS           0x18
+#define BITS_BW_XL_MASK             0x07
+#define BIT_BW_SCAL_ODR             0x04
 #define BITS_FS_XL_MASK             0xE7
 #define BITS_FS_XL_2G               0x00
 #define BITS_FS_XL_4G               0x10
 #define BITS_FS_XL_8G               0x18
 #define BITS_FS_XL_16G              0x08
 
+#define BIT_INT1_FTH                0x08
+#define BIT_INT1_DRDY_G             0x02
+#define BIT_INT1_DRDY_XL            0x01
+#define LSM9DS1_BIT_FIFO_EN         0x02
+#define BITS_FMODE_BYPASS           0x00
+#define BITS_FMODE_CONTINUOUS       0xC0
+#define BITS_FTH_MASK               0x1F
+#define BIT_FIFO_OVRN               0x40
+#define BITS_FSS_MASK               0x3F
+
 // Configuration bits Magnetometer
 #define BITS_TEMP_COMP              0x80
 #define BITS_OM_LOW                 0x00
@@ -171,3 +212,4 @@ private:
 #define BITS_OMZ_MEDIUM             0x04
 #define BITS_OMZ_HIGH               0x08
 #define BITS_OMZ_ULTRA_HIGH         0x0C
+#define BIT_ZYXDA_M                 0x08
@@ -1,34 +1,47 @@
+#include <fcntl.h>
+#include <time.h>
+
 #include "PWM.h"
 #include "Common/Util.h"
 
+#define PWM_SYSFS_PATH "/sys/class/pwm/pwmchip0"
+
+#define DUTY_NS_UNKNOWN 0xFFFFFFFF
+
 PWM::PWM()
+{
+    for (unsigned int i = 0; i < PWM_MAX_CHANNELS; i++)
+    {
+        duty_ns[i] = DUTY_NS_UNKNOWN;
+    }
+    staged_mask = 0;
+    reset_stats();
+}
+
+PWM::~PWM()
 {
 }
 
 bool PWM::init(unsigned int channel)
 {
     int err;
-    err = write_file("/sys/class/pwm/pwmchip0/export", "%u", channel);
-    if (err >= 0 || err == -EBUSY)
-    {
-        return true;
-    }
-    else 
+    err = SysfsAttr::write_once_uint(PWM_SYSFS_PATH "/export", channel);
+    if (err < 0 && err != -EBUSY)
     {
         printf("Can't init channel %u\n", channel);
         return false;
     }
-    return true;
+
+    // The duty_cycle file stays open, the control loop only writes to it
+    return open_duty_cycle(channel);
 }
 
 bool PWM::enable(unsigned int channel)
 {
-    char path[60] = "/sys/class/pwm/pwmchip0";
-    char path_ch[20];
-    sprintf(path_ch, "/pwm%u/enable", channel);
-    strcat(path, path_ch);
-    
-    if (write_file(path, "1") < 0)
+    char path[60];
+    snprintf(path, sizeof(path), PWM_SYSFS_PATH "/pwm%u/enable", channel);
+
+    if (SysfsAttr::write_once(path, "1") < 0)
     {
         printf("Can't enable channel %u\n", channel);
         return false;
@@ -39,13 +52,11 @@ bool PWM::enable(unsigned int channel)
 bool PWM::set_period(unsigned int channel, unsigned int freq)
 {
     int period_ns;
-    char path[60] = "/sys/class/pwm/pwmchip0";
-    char path_ch[20];
-    sprintf(path_ch, "/pwm%u/period", channel);
-    strcat(path, path_ch);
+    char path[60];
+    snprintf(path, sizeof(path), PWM_SYSFS_PATH "/pwm%u/period", channel);
 
     period_ns = 1e9 / freq;
-    if (write_file(path, "%u", period_ns) < 0)
+    if (SysfsAttr::write_once_uint(path, period_ns) < 0)
     {
         printf("Can't set period to channel %u\n", channel);
         return false;
@@ -55,17 +66,155 @@ bool PWM::set_period(unsigned int channel, unsigned int freq)
 
 bool PWM::set_duty_cycle(unsigned int channel, float period)
 {
-    int period_ns;
-    char path[60] = "/sys/class/pwm/pwmchip0";
-    char path_ch[20];
-    sprintf(path_ch, "/pwm%u/duty_cycle", channel);
-    strcat(path, path_ch);
+    return set_duty_cycle_ns(channel, period * 1e6);
+}
 
-    period_ns = period * 1e6;
-    if (write_file(path, "%u", period_ns) < 0)
+/* Opens the duty_cycle file of a channel once, at init() */
+bool PWM::open_duty_cycle(unsigned int channel)
+{
+    if (channel >= PWM_MAX_CHANNELS)
+    {
+        printf("Can't init channel %u\n", channel);
+        return false;
+    }
+
+    if (!duty[channel].is_open())
+    {
+        char path[60];
+        snprintf(path, sizeof(path), PWM_SYSFS_PATH "/pwm%u/duty_cycle", channel);
+        if (duty[channel].open(path, O_WRONLY) < 0)
+        {
+            printf("Can't open duty cycle of channel %u: %s\n", channel, strerror(-duty[channel].last_error()));
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Writes the value only if it differs from the last one written */
+bool PWM::set_duty_cycle_ns(unsigned int channel, unsigned int ns)
+{
+    if (channel >= PWM_MAX_CHANNELS)
     {
         printf("Can't set duty cycle to channel %u\n", channel);
         return false;
     }
+
+    if (ns == duty_ns[channel])
+    {
+        stats[channel].skipped++;
+        return true;
+    }
+
+    if (!duty[channel].is_open())
+    {
+        stats[channel].errors++;
+        printf("Can't set duty cycle to channel %u, not initialized\n", channel);
+        return false;
+    }
+
+    struct timespec done;
+    return write_duty_cycle(channel, ns, &done);
+}
+
+/* Writes a value to an open duty_cycle file, done is set when the write returned */
+bool PWM::write_duty_cycle(unsigned int channel, unsigned int ns, struct timespec *done)
+{
+    PWMStats &stat = stats[channel];
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ret = duty[channel].write_uint(ns);
+    clock_gettime(CLOCK_MONOTONIC, done);
+
+    if (ret < 0)
+    {
+        // Unknown state after a failed write, the next call must write again
+        duty_ns[channel] = DUTY_NS_UNKNOWN;
+        stat.errors++;
+        printf("Can't set duty cycle to channel %u\n", channel);
+        return false;
+    }
+    duty_ns[channel] = ns;
+
+    unsigned int latency = elapsed_us(start, *done);
+    stat.writes++;
+    stat.last_us = latency;
+    stat.total_us += latency;
+    if (latency > stat.max_us)
+        stat.max_us = latency;
+    return true;
+}
+
+unsigned int PWM::elapsed_us(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+/* Keeps the value until commit(), a second call before commit() replaces it */
+bool PWM::stage_duty_cycle(unsigned int channel, float period)
+{
+    if (channel >= PWM_MAX_CHANNELS)
+    {
+        printf("Can't set duty cycle to channel %u\n", channel);
+        return false;
+    }
+
+    staged_ns[channel] = period * 1e6;
+    staged_mask |= 1u << channel;
     return true;
 }
+
+/* Writes all staged values back to back. Unchanged values are skipped and
+   the files were opened at init(), so that only the writes themselves
+   separate the channels. The skew is the time between the
+   first and the last write taking effect. */
+bool PWM::commit()
+{
+    unsigned int channels[PWM_MAX_CHANNELS];
+    unsigned int count = 0;
+    bool ok = true;
+
+    for (unsigned int channel = 0; staged_mask != 0; channel++, staged_mask >>= 1)
+    {
+        if (!(staged_mask & 1))
+            continue;
+
+        if (staged_ns[channel] == duty_ns[channel])
+        {
+            stats[channel].skipped++;
+        }
+        else if (!duty[channel].is_open())
+        {
+            stats[channel].errors++;
+            printf("Can't set duty cycle to channel %u, not initialized\n", channel);
+            ok = false;
+        }
+        else
+        {
+            channels[count++] = channel;
+        }
+    }
+
+    struct timespec first, last;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ok &= write_duty_cycle(channels[i], staged_ns[channels[i]], &last);
+        if (i == 0)
+            first = last;
+    }
+
+    unsigned int skew = count > 1 ? elapsed_us(first, last) : 0;
+    commit_stats.commits++;
+    commit_stats.last_skew_us = skew;
+    commit_stats.total_skew_us += skew;
+    if (skew > commit_stats.max_skew_us)
+        commit_stats.max_skew_us = skew;
+    return ok;
+}
+
+void PWM::reset_stats()
+{
+    memset(stats, 0, sizeof(stats));
+    memset(&commit_stats, 0, sizeof(commit_stats));
+}
@@ -5,16 +5,60 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include "Common/SysfsAttr.h"
+
+#define PWM_MAX_CHANNELS 16
+
+/* Timing of the duty cycle writes of one channel */
+struct PWMStats {
+    unsigned int writes;        // values written to sysfs
+    unsigned int skipped;       // calls with an unchanged value
+    unsigned int errors;
+    unsigned int last_us;       // latency of the last write
+    unsigned int max_us;
+    uint64_t total_us;
+};
+
+/* Time between the first and the last channel update of a commit */
+struct PWMCommitStats {
+    unsigned int commits;
+    unsigned int last_skew_us;
+    unsigned int max_skew_us;
+    uint64_t total_skew_us;
+};
 
 class PWM {
 public:
     PWM();
+    ~PWM();
 
     bool init(unsigned int channel);
     bool enable(unsigned int channel);
     bool set_period(unsigned int channel, unsigned int freq);
     bool set_duty_cycle(unsigned int channel, float period);
+    bool set_duty_cycle_ns(unsigned int channel, unsigned int duty_ns);
+
+    // Update several channels together: stage each value, then commit all
+    bool stage_duty_cycle(unsigned int channel, float period);
+    bool commit();
+
+    const PWMStats& get_stats(unsigned int channel) const { return stats[channel]; }
+    const PWMCommitStats& get_commit_stats() const { return commit_stats; }
+    void reset_stats();
+
+private:
+    bool open_duty_cycle(unsigned int channel);
+    bool write_duty_cycle(unsigned int channel, unsigned int ns, struct timespec *done);
+    static unsigned int elapsed_us(const struct timespec &start, const struct timespec &end);
+
+    SysfsAttr duty[PWM_MAX_CHANNELS];
+    unsigned int duty_ns[PWM_MAX_CHANNELS];
+    unsigned int staged_ns[PWM_MAX_CHANNELS];
+    uint32_t staged_mask;
+    PWMStats stats[PWM_MAX_CHANNELS];
+    PWMCommitStats commit_stats;
 };
 
 #endif //_PWD_H_
-
@@ -0,0 +1,230 @@
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+
+#include "RCIOSampler.h"
+#include <Common/Util.h>
+
+#define ADC_SYSFS_PATH "/sys/kernel/rcio/adc"
+#define RCIN_SYSFS_PATH "/sys/kernel/rcio/rcin"
+
+RCIOSampler::RCIOSampler() :
+    snapshot_seq(0),
+    period_us(1000000 / RCIO_SAMPLE_RATE_HZ),
+    running(false)
+{
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    pthread_mutex_init(&lock, NULL);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+RCIOSampler::~RCIOSampler()
+{
+    stop();
+    close_channels();
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+RCIOSampler& RCIOSampler::get()
+{
+    static RCIOSampler sampler;
+    return sampler;
+}
+
+bool RCIOSampler::start(unsigned int rate_hz)
+{
+    if (running)
+        return true;
+
+    if (rate_hz == 0) {
+        fprintf(stderr, "RCIO sample rate must not be 0\n");
+        return false;
+    }
+    period_us = 1000000 / rate_hz;
+
+    if (!open_channels())
+        return false;
+
+    // The first snapshot is complete before start() returns
+    sample();
+
+    running = true;
+    if (pthread_create(&thread, NULL, run, this) != 0) {
+        fprintf(stderr, "Failed to start RCIO sampler thread\n");
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void RCIOSampler::stop()
+{
+    if (!running)
+        return;
+
+    running = false;
+    pthread_join(thread, NULL);
+}
+
+bool RCIOSampler::open_channels()
+{
+    char path[64];
+    bool ok = true;
+
+    for (size_t i = 0; i < ARRAY_SIZE(adc_attrs); i++) {
+        if (adc_attrs[i].is_open())
+            continue;
+        snprintf(path, sizeof(path), "%s/ch%zu", ADC_SYSFS_PATH, i);
+        if (adc_attrs[i].open(path) < 0) {
+            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(-adc_attrs[i].last_error()));
+            ok = false;
+        }
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(rcin_attrs); i++) {
+        if (rcin_attrs[i].is_open())
+            continue;
+        snprintf(path, sizeof(path), "%s/ch%zu", RCIN_SYSFS_PATH, i);
+        if (rcin_attrs[i].open(path) < 0) {
+            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(-rcin_attrs[i].last_error()));
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+void RCIOSampler::close_channels()
+{
+    for (size_t i = 0; i < ARRAY_SIZE(adc_attrs); i++)
+        adc_attrs[i].close();
+    for (size_t i = 0; i < ARRAY_SIZE(rcin_attrs); i++)
+        rcin_attrs[i].close();
+}
+
+int RCIOSampler::read_channel(SysfsAttr &channel)
+{
+    long value;
+
+    if (channel.read_int(&value) < 0)
+        return -1;
+    return value;
+}
+
+uint64_t RCIOSampler::get_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Reads every channel into a local copy first so that readers only wait
+   out the copy, not the sysfs reads */
+void RCIOSampler::sample()
+{
+    int adc[RCIO_ADC_CHANNELS];
+    int rcin[RCIO_RCIN_CHANNELS];
+
+    for (size_t i = 0; i < ARRAY_SIZE(adc); i++) {
+        adc[i] = read_channel(adc_attrs[i]);
+        if (adc[i] < 0)
+            adc[i] = snapshot.adc[i];
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(rcin); i++) {
+        rcin[i] = read_channel(rcin_attrs[i]);
+        if (rcin[i] < 0)
+            rcin[i] = snapshot.rcin[i];
+    }
+    uint64_t timestamp = get_time_us();
+
+    pthread_mutex_lock(&lock);
+    // The sequence counter is odd while the snapshot is being written
+    snapshot_seq++;
+    __sync_synchronize();
+    memcpy(snapshot.adc, adc, sizeof(adc));
+    memcpy(snapshot.rcin, rcin, sizeof(rcin));
+    snapshot.timestamp = timestamp;
+    snapshot.seq++;
+    __sync_synchronize();
+    snapshot_seq++;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void RCIOSampler::get_snapshot(RCIOSnapshot *result)
+{
+    unsigned int seq;
+    do {
+        seq = snapshot_seq;
+        __sync_synchronize();
+        *result = snapshot;
+        __sync_synchronize();
+    } while ((seq & 1) || seq != snapshot_seq);
+}
+
+bool RCIOSampler::wait_snapshot(unsigned int seq, RCIOSnapshot *result, int timeout_ms)
+{
+    uint64_t deadline = get_time_us() + (uint64_t)timeout_ms * 1000;
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000;
+    ts.tv_nsec = (deadline % 1000000) * 1000;
+
+    bool fresh = true;
+    pthread_mutex_lock(&lock);
+    while (snapshot.seq <= seq) {
+        if (pthread_cond_timedwait(&cond, &lock, &ts) != 0) {
+            fresh = snapshot.seq > seq;
+            break;
+        }
+    }
+    *result = snapshot;
+    pthread_mutex_unlock(&lock);
+
+    return fresh;
+}
+
+int RCIOSampler::read_adc(int ch)
+{
+    __sync_synchronize();
+    return snapshot.adc[ch];
+}
+
+int RCIOSampler::read_rcin(int ch)
+{
+    __sync_synchronize();
+    return snapshot.rcin[ch];
+}
+
+void *RCIOSampler::run(void *arg)
+{
+    ((RCIOSampler *)arg)->loop();
+    return NULL;
+}
+
+void RCIOSampler::loop()
+{
+    uint64_t next = get_time_us();
+
+    while (running) {
+        next += period_us;
+        uint64_t now = get_time_us();
+        if (next < now) {
+            // Fell behind, e.g. on a suspended thread, do not try to catch up
+            next = now;
+        } else {
+            struct timespec ts;
+            ts.tv_sec = next / 1000000;
+            ts.tv_nsec = (next % 1000000) * 1000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+
+        sample();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <pthread.h>
+#include <Common/SysfsAttr.h>
+
+#define RCIO_ADC_CHANNELS       6
+#define RCIO_RCIN_CHANNELS      14
+#define RCIO_SAMPLE_RATE_HZ     50
+
+/* One pass over all rcio channels. Values keep the previous reading if a
+   channel could not be read in this pass. */
+struct RCIOSnapshot {
+    uint64_t timestamp;                 // us, CLOCK_MONOTONIC, end of the pass
+    unsigned int seq;                   // number of passes so far
+    int adc[RCIO_ADC_CHANNELS];         // mV
+    int rcin[RCIO_RCIN_CHANNELS];       // us
+};
+
+/* Background reader of the rcio sysfs attributes. The channel files are
+   opened once and read in a single pass at a fixed rate, one pread per
+   channel without allocating. Readers copy the latest snapshot or
+   a single value without locks and without touching sysfs, or block until
+   the next pass with wait_snapshot(). */
+class RCIOSampler
+{
+public:
+    RCIOSampler();
+    ~RCIOSampler();
+
+    // Shared sampler used by ADC_Navio2 and RCInput_Navio2
+    static RCIOSampler& get();
+
+    bool start(unsigned int rate_hz = RCIO_SAMPLE_RATE_HZ);
+    void stop();
+    bool is_running() const { return running; }
+
+    void get_snapshot(RCIOSnapshot *snapshot);
+    // Waits for a pass newer than seq, false on timeout
+    bool wait_snapshot(unsigned int seq, RCIOSnapshot *snapshot, int timeout_ms);
+
+    // Latest value of one channel, ch must be in range
+    int read_adc(int ch);
+    int read_rcin(int ch);
+
+    // Reads one attribute now, -1 on error
+    static int read_channel(SysfsAttr &channel);
+
+private:
+    RCIOSampler(const RCIOSampler&);
+    RCIOSampler& operator=(const RCIOSampler&);
+
+    bool open_channels();
+    void close_channels();
+    void sample();
+    static uint64_t get_time_us();
+    static void *run(void *arg);
+    void loop();
+
+    SysfsAttr adc_attrs[RCIO_ADC_CHANNELS];
+    SysfsAttr rcin_attrs[RCIO_RCIN_CHANNELS];
+
+    RCIOSnapshot snapshot;
+    volatile unsigned int snapshot_seq;
+
+    unsigned int period_us;
+    volatile bool running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
@@ -1,11 +1,9 @@
 #include <cstdio>
-#include <unistd.h>
-#include <fcntl.h>
-#include <cstdlib>
-#include <err.h>
+#include <cstring>
 
 #include "RCInput_Navio2.h"
 #include <Common/Util.h>
+#include "RCIOSampler.h"
 
 #define RCIN_SYSFS_PATH "/sys/kernel/rcio/rcin"
 
@@ -21,41 +19,36 @@ RCInput_Navio2::~RCInput_Navio2()
 void RCInput_Navio2::initialize()
 {
     for (size_t i = 0; i < ARRAY_SIZE(channels); i++) {
-        channels[i] = open_channel(i);
-        if (channels[i] < 0) {
-            perror("open");
+        if (!open_channel(i)) {
+            fprintf(stderr, "open: %s\n", strerror(-channels[i].last_error()));
         }
     }
+
+    /* All channels are read in the background, unless RCIOSampler::get()
+       was started before with another rate */
+    if (!RCIOSampler::get().start())
+        fprintf(stderr, "RCIO sampler not started, reads go to sysfs\n");
 }
 
 int RCInput_Navio2::read(int ch)
 {
-    if (ch > ARRAY_SIZE(channels) )
-	{	
+    if (ch < 0 || ch >= (int)ARRAY_SIZE(channels))
+    {
         fprintf(stderr,"Channel number too large\n");
         return -1;
-	}
-
-    char buffer[10];
-
-    if (::pread(channels[ch], buffer, ARRAY_SIZE(buffer), 0) < 0) {
-        perror("pread");
     }
 
-    return atoi(buffer);
+    RCIOSampler &sampler = RCIOSampler::get();
+    if (sampler.is_running())
+        return sampler.read_rcin(ch);
+
+    return RCIOSampler::read_channel(channels[ch]);
 }
 
-int RCInput_Navio2::open_channel(int channel)
+bool RCInput_Navio2::open_channel(int channel)
 {
-    char *channel_path;
-    if (asprintf(&channel_path, "%s/ch%d", RCIN_SYSFS_PATH, channel) == -1) {
-        err(1, "channel: %d\n", channel);
-    }
-
-    int fd = ::open(channel_path, O_RDONLY);
+    char channel_path[64];
+    snprintf(channel_path, sizeof(channel_path), "%s/ch%d", RCIN_SYSFS_PATH, channel);
 
-    free(channel_path);
-
-    return fd;
+    return channels[channel].open(channel_path) == 0;
 }
-
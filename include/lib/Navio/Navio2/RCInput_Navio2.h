@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <Common/SysfsAttr.h>
 #include <Common/RCInput.h>
 
 class RCInput_Navio2 : public RCInput
@@ -12,8 +13,8 @@ public:
     ~RCInput_Navio2();
 
 private:
-    int open_channel(int ch);
+    bool open_channel(int ch);
 
     static const size_t CHANNEL_COUNT = 14;
-    int channels[CHANNEL_COUNT];
+    SysfsAttr channels[CHANNEL_COUNT];
 };
@@ -23,3 +23,18 @@ bool RCOutput_Navio2::set_duty_cycle(int channel, float period)
 {
     return pwm.set_duty_cycle(channel, period / 1000);
 }
+
+bool RCOutput_Navio2::stage_duty_cycle(int channel, float period)
+{
+    return pwm.stage_duty_cycle(channel, period / 1000);
+}
+
+bool RCOutput_Navio2::commit()
+{
+    return pwm.commit();
+}
+
+int RCOutput_Navio2::get_commit_skew_us()
+{
+    return pwm.get_commit_stats().last_skew_us;
+}
@@ -13,6 +13,11 @@ public:
     bool enable(int channel) override;
     bool set_frequency(int channel, float frequency) override;
     bool set_duty_cycle(int channel, float period) override;
+    bool stage_duty_cycle(int channel, float period) override;
+    bool commit() override;
+    int get_commit_skew_us() override;
+
+    PWM& get_pwm() { return pwm; }
 
 private:
     PWM pwm;
@@ -5,6 +5,7 @@ Sensors::Sensors (){}
 
 Sensors::Sensors (std::string sensor_name, bool debug = true){
     is_debug = debug;
+    timestamp = 0;
     bias.gx = 0.0;
     bias.gy = 0.0;
     bias.gz = 0.0;
@@ -35,6 +36,7 @@ Sensors::Sensors (std::string sensor_name, bool debug = true){
 
     // Initilaize imu sensor and calibrate gyro
     is->initialize();
+    updateConversion();
     isISEnabled = is->probe();
     if (isISEnabled){
         calibrateGyro();
@@ -42,7 +44,19 @@ Sensors::Sensors (std::string sensor_name, bool debug = true){
 }
 
 void Sensors::update(){
+    // Use the raw path with the fused conversion kernel when the sensor supports it
+    InertialRawSample raw;
+    if (is->update_raw_batch(&raw, 1) == 1) {
+        conv.convert(&raw, reinterpret_cast<float*>(&imu), 1);
+        timestamp = raw.timestamp;
+        if (is_debug){
+            storeData();
+        }
+        return;
+    }
+
     is->update();
+    timestamp = InertialSensor::get_timestamp_us();
     is->read_accelerometer(&imu.ax, &imu.ay, &imu.az);
     is->read_gyroscope(&imu.gx, &imu.gy, &imu.gz);
     is->read_magnetometer(&imu.mx, &imu.my, &imu.mz);
@@ -73,6 +87,87 @@ void Sensors::update(){
 
 }
 
+//**************************************************************************
+// Update batch: read all samples queued by the sensor (e.g. FIFO) and
+// convert them in one pass, imu keeps the latest sample
+//**************************************************************************
+int Sensors::updateBatch(imu_struct *samples, int max_samples){
+    InertialRawSample raw[SENSORS_MAX_BATCH];
+    if (max_samples > SENSORS_MAX_BATCH)
+        max_samples = SENSORS_MAX_BATCH;
+
+    int n = is->update_raw_batch(raw, max_samples);
+    if (n < 0) {
+        // sensor has no raw path, fall back to a single sample
+        update();
+        samples[0] = imu;
+        return 1;
+    }
+
+    conv.convert(raw, reinterpret_cast<float*>(samples), n);
+    if (n > 0) {
+        imu = samples[n - 1];
+        timestamp = raw[n - 1].timestamp;
+    }
+    return n;
+}
+
+//**************************************************************************
+// Update conversion: fold axis rotation, scale, units and gyro bias into
+// the conversion kernel, call after sensor scales or biases change
+//**************************************************************************
+void Sensors::updateConversion(){
+    static const int source[IMU_CHANNELS] = {1, 0, 2, 4, 3, 5, 7, 6, 8};
+    static const float sign[IMU_CHANNELS] = {-1, -1, 1, -1, -1, 1, -1, -1, 1};
+    const float unit[IMU_CHANNELS] = {1 / G_SI, 1 / G_SI, 1 / G_SI, 1, 1, 1, 1, 1, 1};
+    const float offset[IMU_CHANNELS] = {0, 0, 0, bias.gx, bias.gy, bias.gz, 0, 0, 0};
+    float scale[IMU_CHANNELS] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+    is->get_raw_scale(scale);
+    conv.setScale(scale);
+    conv.setRemap(source, sign);
+    conv.setUnit(unit);
+    conv.setBias(offset);
+}
+
+//**************************************************************************
+// Configure: set output data rate, low pass bandwidth and full scale ranges,
+// returns the rate actually set or 0 if the sensor can't change it
+//**************************************************************************
+float Sensors::configure(unsigned int rate_hz, unsigned int lowpass_hz,
+                         unsigned int accel_range_g, unsigned int gyro_range_dps){
+    float rate = is->set_sample_rate(rate_hz);
+    unsigned int lowpass = is->set_lowpass(lowpass_hz);
+    unsigned int accel_range = is->set_accel_range(accel_range_g);
+    unsigned int gyro_range = is->set_gyro_range(gyro_range_dps);
+
+    // full scale ranges change the raw scale
+    updateConversion();
+
+    printf("IMU configuration: rate %.1f Hz, low pass %u Hz, accel %u g, gyro %u dps\n",
+           rate, lowpass, accel_range, gyro_range);
+    return rate;
+}
+
+//**************************************************************************
+// Enable data ready: pace updates on the sensor data-ready interrupt
+//**************************************************************************
+bool Sensors::enableDataReady(uint8_t pin, unsigned int rate_hz){
+    if (!is->enable_data_ready(pin, rate_hz)){
+        printf("Data ready interrupt is not available, using timed sampling\n");
+        return false;
+    }
+    printf("Sampling on data ready interrupt (gpio %u) at %u Hz\n", pin, rate_hz);
+    return true;
+}
+
+//**************************************************************************
+// Wait data ready: block until a new sample is available or timeout
+//**************************************************************************
+bool Sensors::waitDataReady(int timeout_ms){
+    return is->wait_data_ready(timeout_ms);
+}
+
 //**************************************************************************
 // Calibrate Gyroscope sensor: find bias values
 //**************************************************************************
@@ -106,6 +201,7 @@ void Sensors::calibrateGyro()
     bias.gx = offset[0];
     bias.gx = offset[1];
     bias.gx = offset[2];
+    updateConversion();
 }
 //**************************************************************************
 // Get Initial Orientation: find the initial orientation
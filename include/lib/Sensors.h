@@ -4,6 +4,7 @@
 #include "Navio/Common/MPU9250.h"
 #include "Navio/Navio2/LSM9DS1.h"
 #include "Navio/Common/Util.h"
+#include "ImuConversion.h"
 #include <unistd.h>
 #include <string>
 #include <stdio.h>	// file, printf
@@ -14,23 +15,33 @@ namespace {
     #define PI   3.14159
 }
 
+#define SENSORS_MAX_BATCH 64
+
 struct imu_struct{
     float ax, ay, az;
     float gx, gy, gz;
     float mx, my, mz;
 };
+// ImuConversion writes imu_struct as IMU_CHANNELS floats in this order
+static_assert(sizeof(imu_struct) == IMU_CHANNELS * sizeof(float), "imu_struct must be IMU_CHANNELS packed floats");
 
 class Sensors{
 
 public:
     bool isISEnabled;
     struct imu_struct imu;
+    uint64_t timestamp;         // monotonic time of imu in microseconds
     struct imu_struct bias;
     float init_Orient[3];
 
     Sensors ();
     Sensors (std::string sensor_name, bool debug);
     void update();
+    int updateBatch(imu_struct *samples, int max_samples);
+    float configure(unsigned int rate_hz, unsigned int lowpass_hz,
+                    unsigned int accel_range_g, unsigned int gyro_range_dps);
+    bool enableDataReady(uint8_t pin, unsigned int rate_hz);
+    bool waitDataReady(int timeout_ms);
     void calibrateGyro();
     void getInitialOrientation();
 
@@ -38,8 +49,10 @@ private:
     bool is_debug;
     long unsigned time_now;
     InertialSensor *is;
+    ImuConversion conv;     // raw samples to calibrated imu_struct
     FILE * row_data_file;   // File to store row data
 
+    void updateConversion();
     void storeData();
     void getTime();
 };
@@ -38,6 +38,18 @@ float TimeSampling::updateTs(void) {
     return dt;
 }
 
+/******************************************************************************
+measureTs: calculate time stamp without sleeping, used when the loop is paced
+by an external event (e.g. sensor data ready interrupt)
+- returns time difference dt
+******************************************************************************/
+float TimeSampling::measureTs(void) {
+    long ctime = calTime();                     // Calculate current time
+    float dt = (ctime - _ptime) / 1000000.0;    // Calculate dt
+    _ptime = ctime;                             // store for the next time
+    return dt;
+}
+
 /******************************************************************************
 calTime: calculate current time
 - returns lond integer as in (sec * 10^6)
@@ -10,6 +10,7 @@ public:
     TimeSampling(const float freq);
     ~TimeSampling();
     float updateTs(void);
+    float measureTs(void);
     void setFreq(const float freq);
 
 private:
@@ -0,0 +1,31 @@
+#include "TimingMarkers.h"
+
+#ifdef TIMING_MARKERS
+
+#include <stdio.h>
+
+Navio::GpioBank TimingMarkers::_bank;
+uint32_t TimingMarkers::_masks[TIMING_PROBE_COUNT];
+
+bool TimingMarkers::initialize(const int pins[TIMING_PROBE_COUNT])
+{
+    uint32_t all = 0;
+    for (int i = 0; i < TIMING_PROBE_COUNT; i++) {
+        if (pins[i] >= 0 && pins[i] < 32)
+            all |= Navio::GpioBank::mask(pins[i]);
+    }
+
+    if (!_bank.init()) {
+        fprintf(stderr, "Timing markers: cannot map GPIO registers\n");
+        return false;
+    }
+
+    // Start low so that the first rising edge is a real section start
+    _bank.setOutputs(all);
+    _bank.clear(all);
+    for (int i = 0; i < TIMING_PROBE_COUNT; i++)
+        _masks[i] = (pins[i] >= 0 && pins[i] < 32) ? Navio::GpioBank::mask(pins[i]) : 0;
+    return true;
+}
+
+#endif /* TIMING_MARKERS */
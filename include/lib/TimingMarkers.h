@@ -0,0 +1,56 @@
+#ifndef TIMINGMARKERS_H
+#define TIMINGMARKERS_H
+
+/* Timing markers for a logic analyzer: each probe point drives its own GPIO
+   high while the section runs, so the pin shows start, end and jitter of
+   the section at register write resolution. Built with -DTIMING_MARKERS
+   (cmake -DTIMING_MARKERS=ON), otherwise the macros expand to nothing and
+   no GPIO is touched. */
+
+enum TimingProbe {
+    TIMING_PROBE_SENSORS = 0,   // IMU read in the sensors thread
+    TIMING_PROBE_CONTROL,       // control() in the control thread
+    TIMING_PROBE_PWM,           // PWM commit of the motor outputs
+    TIMING_PROBE_COUNT
+};
+
+#ifdef TIMING_MARKERS
+
+#include <stdint.h>
+#include <Common/gpio.h>
+
+class TimingMarkers {
+public:
+    // pins[probe] is a BCM GPIO number, -1 leaves the probe unassigned
+    static bool initialize(const int pins[TIMING_PROBE_COUNT]);
+
+    // One register store each, a probe without pin costs a compare
+    static void begin(TimingProbe probe)
+    {
+        if (_masks[probe])
+            _bank.set(_masks[probe]);
+    }
+    static void end(TimingProbe probe)
+    {
+        if (_masks[probe])
+            _bank.clear(_masks[probe]);
+    }
+
+private:
+    static Navio::GpioBank _bank;
+    static uint32_t _masks[TIMING_PROBE_COUNT];
+};
+
+#define TIMING_MARKERS_INIT(pins)   TimingMarkers::initialize(pins)
+#define TIMING_MARK_BEGIN(probe)    TimingMarkers::begin(probe)
+#define TIMING_MARK_END(probe)      TimingMarkers::end(probe)
+
+#else
+
+#define TIMING_MARKERS_INIT(pins)   ((void)(pins), true)
+#define TIMING_MARK_BEGIN(probe)    do {} while (0)
+#define TIMING_MARK_END(probe)      do {} while (0)
+
+#endif /* TIMING_MARKERS */
+
+#endif /* TIMINGMARKERS_H */
@@ -10,9 +10,12 @@
 Header files
 **************************************************************************************************/
 #include "../lib/Navio/Common/Util.h"               // Navio Utility
-#include "../lib/Navio/Navio2/PWM.h"                // Navio PWM output
+#include "../lib/Navio/Navio2/RCOutput_Navio2.h"    // Navio2 PWM output
+#include "../lib/Navio/Navio+/RCOutput_Navio.h"     // Navio+ PCA9685 PWM output
 #include "iostream"
+#include <string>
 #include "../lib/rotor.h"                           //
+#include "../lib/TimingMarkers.h"                   // GPIO markers at the PWM commit
 
 /**************************************************************************************************
 Global variables
@@ -20,29 +23,75 @@ Global variables
 #define _PWM_MIN 0.85                               // PWM duty cycle in mS
 #define _PWM_MAX 2.00                               // PWM duty cycle in mS
 #define _PWM_FREQ 50                                // PWM period in Hz
+enum OutputMode {                                   // ESC signal, see navio_interface::modes
+  OUTPUT_SERVO = 0,                                 // standard 50 Hz servo pulses
+  OUTPUT_FAST_PWM,                                  // 400 Hz pulses with the servo range
+  OUTPUT_ONESHOT125                                 // 125-250 uS pulses at 1 kHz
+};
+struct outputModeStruct {
+  const char *name;                                 // name used in rosparm
+  int freq;                                         // PWM period in Hz
+  float min;                                        // pulse of zero thrust in mS
+  float max;                                        // pulse of full thrust in mS
+};
 namespace navio_interface {
 int ch[4] = {0, 1, 2, 3};                           // Channel# {front, right, back, left}
 float scale[4] = {1.03, 1.0, 0.98, 1.0};            // Scale value for servos
 float offset = 0.15;                                // Offset value for servos
+const outputModeStruct modes[] = {
+  {"servo",      _PWM_FREQ, _PWM_MIN, _PWM_MAX},
+  {"fast_pwm",   400,       _PWM_MIN, _PWM_MAX},
+  {"oneshot125", 1000,      0.125,    0.250}
+};
+/************************************************************************************************
+   parseOutputMode: find output mode by name, false if unknown
+************************************************************************************************/
+inline bool parseOutputMode(const std::string& name, OutputMode *mode) {
+  for (unsigned int i=0; i<ARRAY_SIZE(modes); i++){
+    if (name == modes[i].name) {
+      *mode = (OutputMode)i;
+      return true;
+    }
+  }
+  return false;
+}
 }
 /**************************************************************************************************
 Class
 **************************************************************************************************/
 class NavioInterface{
 public:
-  NavioInterface(){}
+  NavioInterface(): _pwm(&_navio2), _mode(&navio_interface::modes[OUTPUT_SERVO]){}
   ~NavioInterface(){}
   /************************************************************************************************
-     initialize: Initialize PWM object used in Navio2 board
+     initialize: Initialize PWM output of the detected board with the given ESC signal
   ************************************************************************************************/
-  void initialize() {
+  void initialize(OutputMode mode = OUTPUT_SERVO) {
+    // Navio2 drives the motors through the RCIO sysfs PWM, Navio+ through the PCA9685.
+    // The testbed is a Navio2, only an explicit Navio+ id selects the PCA9685
+    int version = get_navio_version();
+    if (version == NAVIO)
+      _pwm = &_navio;
+    else {
+      if (version != NAVIO2)
+        printf("PWM output: could not detect the Navio board (id %d), assuming Navio2\n", version);
+      _pwm = &_navio2;
+    }
+    _mode = &navio_interface::modes[mode];
+    printf("PWM output: %s on %s, %d Hz, %.3f-%.3f mS\n", _mode->name,
+           _pwm == &_navio2 ? "Navio2" : "Navio+", _mode->freq, _mode->min, _mode->max);
     for (int i=0; i<4; i++){
       // initialize pwm channels
-      _pwm->init(navio_interface::ch[i]);
-      // set period to _FREQ = 50;
-      _pwm->set_period(navio_interface::ch[i], _PWM_FREQ);
-      // set initiale duty cycle to minimum == motor off
-      _pwm->set_duty_cycle(navio_interface::ch[i], _PWM_MIN);
+      _pwm->initialize(navio_interface::ch[i]);
+      // clear the pulse before the period so that a pulse left from a slower mode never
+      // exceeds a shorter period, 0 is also the only duty cycle accepted while a freshly
+      // exported Navio2 channel has no period yet
+      _pwm->set_duty_cycle(navio_interface::ch[i], 0);
+      // set period of the output mode
+      _pwm->set_frequency(navio_interface::ch[i], _mode->freq);
+      // set initiale duty cycle to minimum == motor off, after the period since the
+      // PCA9685 counts the pulse in steps of it
+      _pwm->set_duty_cycle(navio_interface::ch[i], _mode->min * 1000);
       // enable pwm channels
       _pwm->enable(navio_interface::ch[i]);
       // create a rotor object for each channel
@@ -94,21 +143,58 @@ public:
     // set PWM duty cycle to maximum
     send(min, min, max);
   }
+  /************************************************************************************************
+     printPWMStats: print write latency per motor and skew between motors since the last call
+  ************************************************************************************************/
+  void printPWMStats() {
+    // the PCA9685 updates all motors with one I2C write, there are no per motor writes
+    if (_pwm != &_navio2) {
+      printf("PWM skew between motors %d us\n", _pwm->get_commit_skew_us());
+      return;
+    }
+    PWM &pwm = _navio2.get_pwm();
+    for (int i=0; i<4; i++){
+      const PWMStats &stats = pwm.get_stats(navio_interface::ch[i]);
+      printf("PWM ch%d: %u writes, %u unchanged, %u errors, latency avg %u us, max %u us\n",
+             navio_interface::ch[i], stats.writes, stats.skipped, stats.errors,
+             stats.writes ? (unsigned int)(stats.total_us / stats.writes) : 0, stats.max_us);
+    }
+    const PWMCommitStats &commit = pwm.get_commit_stats();
+    printf("PWM commits: %u, skew between motors avg %u us, max %u us\n", commit.commits,
+           commit.commits ? (unsigned int)(commit.total_skew_us / commit.commits) : 0, commit.max_skew_us);
+    pwm.reset_stats();
+  }
+
+  /************************************************************************************************
+     getOutputMode: ESC signal in use
+  ************************************************************************************************/
+  const outputModeStruct& getOutputMode() {
+    return *_mode;
+  }
 
 private:
-  PWM *_pwm;
+  RCOutput_Navio2 _navio2;
+  RCOutput_Navio _navio;
+  RCOutput *_pwm;                                   // backend of the detected board
   Rotor _rotors[4];
+  const outputModeStruct *_mode;
   /************************************************************************************************
    setPWMADuty: send PWM signal to motor
   ************************************************************************************************/
   void setPWMDuty(float duty[4]) {
+    // duty is given in mS above _PWM_MIN of the servo range, other modes scale it to their range
+    float gain = (_mode->max - _mode->min) / (_PWM_MAX - _PWM_MIN);
     for (int i=0; i<4; i++){
       // add minmum PWM value and apply saturation for PWM
-      float tmp = sat(duty[i] * navio_interface::scale[i] + navio_interface::offset + _PWM_MIN,
-                      _PWM_MIN, _PWM_MAX);
-      // set PWM duty
-      _pwm->set_duty_cycle(navio_interface::ch[i], tmp);
+      float tmp = sat((duty[i] * navio_interface::scale[i] + navio_interface::offset) * gain + _mode->min,
+                      _mode->min, _mode->max);
+      // stage PWM duty in uS
+      _pwm->stage_duty_cycle(navio_interface::ch[i], tmp * 1000);
     }
+    // update all motors together
+    TIMING_MARK_BEGIN(TIMING_PROBE_PWM);
+    _pwm->commit();
+    TIMING_MARK_END(TIMING_PROBE_PWM);
   }
   /************************************************************************************************
    sat: apply saturation
@@ -12,6 +12,7 @@ Header files
 #include <signal.h>                               // signal ctrl+c
 #include <stdio.h>                                // printf
 #include "lib/TimeSampling.h"                     // time sampling library
+#include "lib/TimingMarkers.h"                    // GPIO markers for loop profiling
 #include <testbed_navio/ros_node.h>               // ros node class
 #include <testbed_navio/navio_interface.h>        // navio interface pwm, sensors ...
 #include <lib/Sensors.h>                          //
@@ -22,9 +23,11 @@ Header files
 /**************************************************************************************************
 Global variables
 **************************************************************************************************/
-#define _SENSORS_FREQ   400                       // Sensors thread frequency in Hz
+#define _SENSORS_FREQ   500                       // Sensors thread default frequency in Hz, see imuConfig
 #define _ROSNODE_FREQ   100                       // Rosnode thread frequency in Hz
 #define _CONTROL_FREQ   200                       // Control thread frequency in Hz
+#define _SENSORS_DRDY_PIN RPI_GPIO_23             // IMU data ready pin, see imuConfig.data_ready
+#define _SENSORS_DRDY_MISSES 3                    // data ready timeouts before going back to timed sampling
 
 pthread_t _Thread_Sensors;
 pthread_t _Thread_Control;
@@ -42,10 +45,18 @@ struct controlStruct {                            // getting parameters form ros
   std::vector<double> kr;
   std::vector<double> kw;
 };
+struct imuStruct {                                // IMU configuration from rosparm
+  int rate;                                       // output data rate in Hz
+  int lowpass;                                    // low pass filter bandwidth in Hz
+  int accel_range;                                // accelerometer full scale in g
+  int gyro_range;                                 // gyroscope full scale in dps
+  bool data_ready;                                // pace sampling on the IMU data ready interrupt
+};
 struct dataStruct {                               // main data structure
   bool is_control_ready;
   bool is_rosnode_ready;
   bool is_sensors_ready;
+  bool is_params_ready;
 
   float du[4];                // output PWM signal
   int enc_dir[3];
@@ -61,6 +72,8 @@ struct dataStruct {                               // main data structure
   RosNode* rosnode;
   Sensors* sensors;
   controlStruct angConGain;
+  imuStruct imuConfig;
+  OutputMode output_mode;     // ESC signal from rosparm
 
   int argc;
   char** argv;
@@ -102,6 +115,7 @@ dataStruct* mainInitialize(int argc, char** argv)
   data->is_control_ready = false;
   data->is_rosnode_ready = false;
   data->is_sensors_ready = false;
+  data->is_params_ready = false;
 
   // Start threads --------------------------------------------------------------------------------
   pthread_create(&_Thread_Control, NULL, controlThread, (void *) &data);
@@ -176,9 +190,11 @@ void *controlThread(void *data) {
   // Initialize sampling time
   TimeSampling ts(_CONTROL_FREQ);
 
-  // Initialize PWM
+  // Initialize PWM with the output mode from rosparm
+  while (!my_data->is_params_ready && !_CloseRequested)
+    usleep(1000);
   NavioInterface navio;
-  navio.initialize();
+  navio.initialize(my_data->output_mode);
   my_data->du[0] = 0.0;
   my_data->du[1] = 0.0;
   my_data->du[2] = 0.0;
@@ -200,7 +216,9 @@ void *controlThread(void *data) {
       // Check sampling
       if (dt < 0.02) {
         // Run control function
+        TIMING_MARK_BEGIN(TIMING_PROBE_CONTROL);
         control(my_data, dt);
+        TIMING_MARK_END(TIMING_PROBE_CONTROL);
       }
       else{
         printf("Control thread: sampling time is too big = %f\n", dt);
@@ -218,6 +236,7 @@ void *controlThread(void *data) {
     if (dtsumm > 5.0) {
       dtsumm = 0;
       printf("Control thread: running with %4d Hz\n", int(1 / dt));
+      navio.printPWMStats();
     }
   }
 
@@ -263,16 +282,50 @@ void *sensorsThread(void *data) {
   // Announce sensors thread is ready
   my_data->is_sensors_ready = true;
 
+  // Configure IMU from rosparm, the loop runs at the output data rate actually set
+  while (!my_data->is_params_ready && !_CloseRequested)
+    usleep(1000);
+  imuStruct *cfg = &my_data->imuConfig;
+  float freq = my_data->sensors->configure(cfg->rate, cfg->lowpass, cfg->accel_range, cfg->gyro_range);
+  if (freq <= 0)
+    freq = cfg->rate;
+
+  // Pace the loop on the IMU data ready interrupt when it is enabled in rosparm
+  bool drdy = false;
+  int drdy_misses = 0;
+  if (cfg->data_ready)
+    drdy = my_data->sensors->enableDataReady(_SENSORS_DRDY_PIN, freq);
+
   // Main loop ------------------------------------------------------------------------------------
-  TimeSampling ts(_SENSORS_FREQ);
+  TimeSampling ts(freq);
   float dt, dtsum1 = 0, dtsum2;
+  uint64_t last_sample_us = 0;
   printf("sensor is ready now\n");
   while (!_CloseRequested) {
-    // calculate sampling time
-    dt = ts.updateTs();
+    // calculate sampling time, fall back to timed sampling if no new sample arrives
+    bool drdy_sample = drdy && my_data->sensors->waitDataReady(100);
+    if (drdy_sample) {
+      drdy_misses = 0;
+      dt = ts.measureTs();  // keeps the timed fallback in step
+    }
+    else {
+      // nothing may be wired to the pin, do not keep waiting for it
+      if (drdy && ++drdy_misses >= _SENSORS_DRDY_MISSES) {
+        printf("Sensors thread: no data ready interrupt on gpio %d, using timed sampling\n", _SENSORS_DRDY_PIN);
+        drdy = false;
+      }
+      dt = ts.updateTs();
+    }
 
     // update Sensor
+    TIMING_MARK_BEGIN(TIMING_PROBE_SENSORS);
     my_data->sensors->update();
+    TIMING_MARK_END(TIMING_PROBE_SENSORS);
+
+    // paced samples are stamped with their data ready edge, dt is the time between them
+    if (drdy_sample && last_sample_us)
+      dt = (my_data->sensors->timestamp - last_sample_us) * 1e-6f;
+    last_sample_us = my_data->sensors->timestamp;
 
     // Display info for user every 5 second
     dtsum1 += dt;
@@ -425,6 +478,48 @@ void initializeParams(ros::NodeHandle& n, dataStruct* data){
   data->enc_dir[1] = enc_dir[1];
   data->enc_dir[2] = enc_dir[2];
 
+  // Get motors output mode ----------------------------------------------------------------------
+  std::string output_mode;
+  if (n.getParam("testbed/motors/output_mode", output_mode) &&
+      navio_interface::parseOutputMode(output_mode, &data->output_mode))
+    ROS_INFO("Found motors output mode %s", output_mode.c_str());
+  else {
+    ROS_INFO("Can't find motors output mode, using servo");
+    data->output_mode = OUTPUT_SERVO;
+  }
+
+  // Get IMU configuration ------------------------------------------------------------------------
+  if (n.getParam("testbed/sensors/imu/rate", data->imuConfig.rate) && data->imuConfig.rate > 0)
+    ROS_INFO("Found IMU rate");
+  else {
+    ROS_INFO("Can't find a valid IMU rate");
+    data->imuConfig.rate = _SENSORS_FREQ;
+  }
+  if (!n.getParam("testbed/sensors/imu/lowpass", data->imuConfig.lowpass))
+    data->imuConfig.lowpass = 184;
+  if (!n.getParam("testbed/sensors/imu/accel_range", data->imuConfig.accel_range))
+    data->imuConfig.accel_range = 16;
+  if (!n.getParam("testbed/sensors/imu/gyro_range", data->imuConfig.gyro_range))
+    data->imuConfig.gyro_range = 2000;
+  if (!n.getParam("testbed/sensors/imu/data_ready", data->imuConfig.data_ready))
+    data->imuConfig.data_ready = false;
+
+  // Get timing marker pins, only used in builds with TIMING_MARKERS ------------------------------
+#ifdef TIMING_MARKERS
+  std::vector<int> marker_pins;
+  int pins[TIMING_PROBE_COUNT] = {-1, -1, -1};
+  if (n.getParam("testbed/timing_markers/pins", marker_pins)) {
+    for (int i = 0; i < TIMING_PROBE_COUNT && i < (int)marker_pins.size(); i++)
+      pins[i] = marker_pins[i];
+    ROS_INFO("Found timing marker pins");
+  }
+  else
+    ROS_INFO("Can't find timing marker pins, markers are off");
+  if (!TIMING_MARKERS_INIT(pins))
+    ROS_INFO("Timing markers could not be initialized");
+#endif
+  data->is_params_ready = true;
+
   // print result ---------------------------------------------------------------------------------
   ROS_INFO("control kp gains are set to: kp[0] %f, kp[1] %f, kp[2] %f\n",
            data->angConGain.kp[0],data->angConGain.kp[1],data->angConGain.kp[2]);
@@ -443,6 +538,10 @@ void initializeParams(ros::NodeHandle& n, dataStruct* data){
   ROS_INFO(" - roll  = %+d\n", data->enc_dir[0]);
   ROS_INFO(" - pitch = %+d\n", data->enc_dir[1]);
   ROS_INFO(" - yaw   = %+d\n", data->enc_dir[2]);
+  ROS_INFO("IMU configuration: rate %d Hz, low pass %d Hz, accel %d g, gyro %d dps, data ready %s\n",
+           data->imuConfig.rate, data->imuConfig.lowpass,
+           data->imuConfig.accel_range, data->imuConfig.gyro_range,
+           data->imuConfig.data_ready ? "on" : "off");
 }
 
 /**************************************************************************************************
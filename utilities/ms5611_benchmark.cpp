@@ -0,0 +1,153 @@
+/*
+ * File:   ms5611_benchmark.cpp
+ * Compare the integer MS5611 compensation and the table altitude conversion
+ * with the previous float/pow() versions: run time per sample and largest
+ * difference over a sweep of raw pressure and temperature values.
+ * Runs on synthetic data, no barometer needed.
+ */
+#include "Common/MS5611.h"
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#define ITERATIONS 200000
+
+// Calibration and conversion example from the MS5611 datasheet
+static const uint16_t prom[6] = {40127, 36924, 23317, 23282, 33464, 28312};
+static const uint32_t example_d1 = 9085466;
+static const uint32_t example_d2 = 8569150;
+
+long timeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+// Previous MS5611::calculatePressureAndTemperature
+void compensateFloat(const uint16_t C[6], uint32_t D1, uint32_t D2, float *TEMP, float *PRES)
+{
+  float dT = D2 - C[4] * pow(2, 8);
+  *TEMP = (2000 + ((dT * C[5]) / pow(2, 23)));
+  float OFF = C[1] * pow(2, 16) + (C[3] * dT) / pow(2, 7);
+  float SENS = C[0] * pow(2, 15) + (C[2] * dT) / pow(2, 8);
+
+  float T2 = 0, OFF2 = 0, SENS2 = 0;
+  if (*TEMP < 2000) {
+    T2 = dT * dT / pow(2, 31);
+    OFF2 = 5 * pow(*TEMP - 2000, 2) / 2;
+    SENS2 = OFF2 / 2;
+  }
+  if (*TEMP < -1500) {
+    OFF2 = OFF2 + 7 * pow(*TEMP + 1500, 2);
+    SENS2 = SENS2 + 11 * pow(*TEMP + 1500, 2) / 2;
+  }
+
+  *TEMP = *TEMP - T2;
+  OFF = OFF - OFF2;
+  SENS = SENS - SENS2;
+
+  *PRES = ((D1 * SENS) / pow(2, 21) - OFF) / pow(2, 15) / 100;
+  *TEMP = *TEMP / 100;
+}
+
+// Exact reference in double precision
+void compensateDouble(const uint16_t C[6], uint32_t D1, uint32_t D2, double *TEMP, double *PRES)
+{
+  double dT = D2 - C[4] * 256.0;
+  double T = 2000 + dT * C[5] / 8388608.0;
+  double OFF = C[1] * 65536.0 + C[3] * dT / 128.0;
+  double SENS = C[0] * 32768.0 + C[2] * dT / 256.0;
+
+  if (T < 2000) {
+    double T2 = dT * dT / 2147483648.0;
+    double OFF2 = 5 * (T - 2000) * (T - 2000) / 2;
+    double SENS2 = 5 * (T - 2000) * (T - 2000) / 4;
+    if (T < -1500) {
+      OFF2 += 7 * (T + 1500) * (T + 1500);
+      SENS2 += 11 * (T + 1500) * (T + 1500) / 2;
+    }
+    T -= T2;
+    OFF -= OFF2;
+    SENS -= SENS2;
+  }
+
+  *PRES = (D1 * SENS / 2097152.0 - OFF) / 32768.0 / 100;
+  *TEMP = T / 100;
+}
+
+int main(int argc, char** argv)
+{
+  int32_t temp_int, pres_int;
+  float temp_float, pres_float;
+  volatile float sink = 0;
+
+  // Datasheet example: 20.07 degC and 1000.09 mbar
+  MS5611::compensate(prom, example_d1, example_d2, &temp_int, &pres_int);
+  compensateFloat(prom, example_d1, example_d2, &temp_float, &pres_float);
+  printf("Datasheet example (20.07 degC, 1000.09 mbar)\n");
+  printf("  integer: %7.2f degC %8.2f mbar\n", temp_int / 100.0, pres_int / 100.0);
+  printf("  float:   %7.2f degC %8.2f mbar\n\n", temp_float, pres_float);
+
+  // Accuracy over raw temperatures from about -40 to +85 degC and the pressure range
+  double max_int_p = 0, max_int_t = 0, max_float_p = 0, max_float_t = 0;
+  for (uint32_t d2 = 7000000; d2 <= 9800000; d2 += 20000) {
+    for (uint32_t d1 = 2000000; d1 <= 10000000; d1 += 50000) {
+      double temp_ref, pres_ref;
+      compensateDouble(prom, d1, d2, &temp_ref, &pres_ref);
+      MS5611::compensate(prom, d1, d2, &temp_int, &pres_int);
+      compensateFloat(prom, d1, d2, &temp_float, &pres_float);
+
+      max_int_p = fmax(max_int_p, fabs(pres_int / 100.0 - pres_ref));
+      max_int_t = fmax(max_int_t, fabs(temp_int / 100.0 - temp_ref));
+      max_float_p = fmax(max_float_p, fabs(pres_float - pres_ref));
+      max_float_t = fmax(max_float_t, fabs(temp_float - temp_ref));
+    }
+  }
+  // The integer results truncate to the 0.01 resolution of the datasheet math
+  printf("Largest difference to unrounded double precision math\n");
+  printf("  integer: %8.4f degC %8.4f mbar\n", max_int_t, max_int_p);
+  printf("  float:   %8.4f degC %8.4f mbar\n\n", max_float_t, max_float_p);
+
+  // Run time
+  long start = timeUs();
+  for (int n = 0; n < ITERATIONS; n++) {
+    MS5611::compensate(prom, example_d1 + n % 4096, example_d2 - n % 4096, &temp_int, &pres_int);
+    sink += pres_int;
+  }
+  float time_int = (timeUs() - start) * 1000.0 / ITERATIONS;
+
+  start = timeUs();
+  for (int n = 0; n < ITERATIONS; n++) {
+    compensateFloat(prom, example_d1 + n % 4096, example_d2 - n % 4096, &temp_float, &pres_float);
+    sink += pres_float;
+  }
+  float time_float = (timeUs() - start) * 1000.0 / ITERATIONS;
+
+  printf("Compensation time per sample\n");
+  printf("  integer: %8.1f ns\n", time_int);
+  printf("  float:   %8.1f ns\n\n", time_float);
+
+  // Altitude conversion
+  double max_alt = 0;
+  for (float p = 300; p <= 1100; p += 0.05) {
+    double exact = 44330.0 * (1.0 - pow(p / MS5611_SEA_LEVEL_PRESSURE, 0.190295));
+    max_alt = fmax(max_alt, fabs(MS5611::pressureToAltitude(p, MS5611_SEA_LEVEL_PRESSURE) - exact));
+  }
+
+  start = timeUs();
+  for (int n = 0; n < ITERATIONS; n++)
+    sink += MS5611::pressureToAltitude(900 + (n % 2000) * 0.1f, MS5611_SEA_LEVEL_PRESSURE);
+  float time_table = (timeUs() - start) * 1000.0 / ITERATIONS;
+
+  start = timeUs();
+  for (int n = 0; n < ITERATIONS; n++)
+    sink += 44330.0 * (1.0 - pow((900 + (n % 2000) * 0.1f) / MS5611_SEA_LEVEL_PRESSURE, 0.190295));
+  float time_pow = (timeUs() - start) * 1000.0 / ITERATIONS;
+
+  printf("Altitude from 300 to 1100 mbar\n");
+  printf("  table: %8.1f ns, largest error %.4f m\n", time_table, max_alt);
+  printf("  pow:   %8.1f ns\n", time_pow);
+
+  return 0;
+}
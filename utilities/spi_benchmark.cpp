@@ -0,0 +1,49 @@
+/*
+ * File:   spi_benchmark.cpp
+ * Measure the time of one MPU9250 sample burst (accel, temp, gyro and
+ * magnetometer registers) at different SPI clock speeds.
+ */
+#include "Common/SPIdev.h"
+#include "Common/MPU9250.h"
+#include "Common/Util.h"
+#include <time.h>
+
+#define BURST_LENGTH 22                     // read command + 21 data bytes
+#define ITERATIONS   2000
+
+static const unsigned int speeds[] = {1000000, 5000000, 10000000, 20000000};
+
+long timeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char** argv)
+{
+  SPIdev spi("/dev/spidev0.1", MPU9250_SPI_SLOW_HZ, speeds[ARRAY_SIZE(speeds) - 1]);
+  unsigned char tx[BURST_LENGTH] = {0};
+  unsigned char rx[BURST_LENGTH] = {0};
+
+  // check the sensor answers at the configuration clock
+  tx[0] = MPUREG_WHOAMI | READ_FLAG;
+  if (spi.transfer(tx, rx, 2) < 0 || rx[1] != 0x71) {
+    printf("MPU9250 not found (whoami 0x%02x)\n", rx[1]);
+    return 1;
+  }
+
+  printf("  speed [MHz]   burst [us]   accel x (raw)\n");
+  tx[0] = MPUREG_ACCEL_XOUT_H | READ_FLAG;
+  for (unsigned int i = 0; i < ARRAY_SIZE(speeds); i++) {
+    long start = timeUs();
+    for (int n = 0; n < ITERATIONS; n++)
+      spi.transfer(tx, rx, BURST_LENGTH, speeds[i]);
+    float burst = (timeUs() - start) / float(ITERATIONS);
+
+    short ax = (rx[1] << 8) | rx[2];
+    printf("  %11.1f   %10.1f   %13d\n", speeds[i] / 1e6, burst, ax);
+  }
+
+  return 0;
+}
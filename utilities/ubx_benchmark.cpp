@@ -0,0 +1,271 @@
+/*
+ * File:   ubx_benchmark.cpp
+ * Decode throughput of the UBX parser on a synthetic receiver stream:
+ * the previous byte shifting decoder into a vector, the vector decoder over
+ * the typed payload structs and the dispatch table. The stream mixes valid
+ * messages of the supported types with unknown messages, corrupted
+ * checksums, truncated frames and line noise, and the decoders are checked
+ * against each other on every message. Runs on random data, no receiver needed.
+ */
+#include "Common/Ublox.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STREAM_LENGTH (4 * 1024 * 1024)
+#define PASSES 5
+
+struct Counts {
+  long pvt, posllh, velned, status, timtp;
+  long long checksum;             // keeps the compiler from dropping the reads
+};
+
+long timeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+// Previous UBXParser::decodeMessage, message is the start of a complete message
+int decodeShift(const unsigned char *message, unsigned int length, std::vector<double>& data)
+{
+  uint8_t CK_A = 0, CK_B = 0;
+
+  if (message[0] != 0xb5 || message[1] != 0x62)
+    return 0;
+  for (unsigned int i = 2; i < length - 2; i++) {
+    CK_A += message[i];
+    CK_B += CK_A;
+  }
+  if (CK_A != message[length - 2] || CK_B != message[length - 1])
+    return 0;
+
+  uint16_t id = message[2] << 8 | message[3];
+  switch (id) {
+  case 0x0102:
+    data.clear();
+    for (int offset = 6; offset < 34; offset += 4) {
+      int32_t value = message[offset + 3] << 24 | message[offset + 2] << 16 | message[offset + 1] << 8 | message[offset];
+      if (offset == 6 || offset >= 26)
+        data.push_back((unsigned)value);
+      else
+        data.push_back(value);
+    }
+    return id;
+  case 0x0103:
+    data.clear();
+    data.push_back(message[10]);
+    data.push_back(message[11]);
+    return id;
+  default:
+    return 0;
+  }
+}
+
+void onPvt(void *arg, const UBXNavPVT *pvt)
+{
+  Counts *counts = (Counts *)arg;
+  counts->pvt++;
+  counts->checksum += pvt->lat + pvt->lon + pvt->velN + pvt->numSV;
+}
+
+void onPosllh(void *arg, const UBXNavPOSLLH *posllh)
+{
+  Counts *counts = (Counts *)arg;
+  counts->posllh++;
+  counts->checksum += posllh->lat + posllh->lon + posllh->hMSL;
+}
+
+void onVelned(void *arg, const UBXNavVELNED *velned)
+{
+  Counts *counts = (Counts *)arg;
+  counts->velned++;
+  counts->checksum += velned->velN + velned->velE + velned->velD;
+}
+
+void onStatus(void *arg, const UBXNavSTATUS *status)
+{
+  Counts *counts = (Counts *)arg;
+  counts->status++;
+  counts->checksum += status->gpsFix + status->flags;
+}
+
+void onTimTp(void *arg, const UBXTimTP *timtp)
+{
+  Counts *counts = (Counts *)arg;
+  counts->timtp++;
+  counts->checksum += timtp->towMS + timtp->qErr;
+}
+
+// Appends one framed message with a random payload, returns the bytes written
+unsigned int putMessage(unsigned char *out, uint8_t cls, uint8_t id, unsigned int payload_length)
+{
+  uint8_t CK_A = 0, CK_B = 0;
+
+  out[0] = 0xb5;
+  out[1] = 0x62;
+  out[2] = cls;
+  out[3] = id;
+  out[4] = payload_length & 0xff;
+  out[5] = payload_length >> 8;
+  for (unsigned int i = 0; i < payload_length; i++)
+    out[6 + i] = rand();
+  for (unsigned int i = 2; i < 6 + payload_length; i++) {
+    CK_A += out[i];
+    CK_B += CK_A;
+  }
+  out[6 + payload_length] = CK_A;
+  out[7 + payload_length] = CK_B;
+  return payload_length + 8;
+}
+
+unsigned int fillStream(unsigned char *stream, unsigned int size, long *frames)
+{
+  static const uint16_t ids[] = {UBXNavPVT::ID, UBXNavPOSLLH::ID, UBXNavVELNED::ID, UBXNavSTATUS::ID, UBXTimTP::ID};
+  static const unsigned int lengths[] = {sizeof(UBXNavPVT), sizeof(UBXNavPOSLLH), sizeof(UBXNavVELNED),
+                                         sizeof(UBXNavSTATUS), sizeof(UBXTimTP)};
+  unsigned int used = 0;
+
+  *frames = 0;
+  while (used + 8 + 256 < size) {
+    int kind = rand() % 100;
+    unsigned char *out = stream + used;
+
+    if (kind < 70) {
+      int type = rand() % 5;
+      used += putMessage(out, ids[type] >> 8, ids[type] & 0xff, lengths[type]);
+    } else if (kind < 80) {
+      // Message type nobody decodes
+      used += putMessage(out, 0x0a, rand() % 256, rand() % 200);
+    } else if (kind < 85) {
+      // Supported type with a short payload
+      int type = rand() % 5;
+      used += putMessage(out, ids[type] >> 8, ids[type] & 0xff, rand() % lengths[type]);
+    } else if (kind < 90) {
+      // Corrupted byte, mostly breaks the checksum
+      int type = rand() % 5;
+      unsigned int length = putMessage(out, ids[type] >> 8, ids[type] & 0xff, lengths[type]);
+      out[2 + rand() % (length - 2)] ^= 1 << (rand() % 8);
+      used += length;
+    } else if (kind < 95) {
+      // Truncated frame
+      int type = rand() % 5;
+      used += rand() % putMessage(out, ids[type] >> 8, ids[type] & 0xff, lengths[type]);
+    } else {
+      // Idle filler and line noise
+      unsigned int length = rand() % 64;
+      for (unsigned int i = 0; i < length; i++)
+        out[i] = rand() % 4 ? 0xff : rand();
+      used += length;
+    }
+    (*frames)++;
+  }
+  return used;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned char *stream = new unsigned char[STREAM_LENGTH];
+  long frames;
+  unsigned int length;
+
+  srand(argc > 1 ? atoi(argv[1]) : 1);
+  length = fillStream(stream, STREAM_LENGTH, &frames);
+  printf("Stream of %u bytes, %ld frames\n\n", length, frames);
+
+  UBXScanner scanner;
+  UBXParser parser(&scanner);
+  UBXDispatcher dispatcher;
+  Counts counts;
+  std::vector<double> data_shift, data_struct;
+  long messages = 0, mismatches = 0;
+
+  memset(&counts, 0, sizeof(counts));
+  dispatcher.add(onPvt, &counts);
+  dispatcher.add(onPosllh, &counts);
+  dispatcher.add(onVelned, &counts);
+  dispatcher.add(onStatus, &counts);
+  dispatcher.add(onTimTp, &counts);
+
+  // Both vector decoders have to agree on every message the scanner finds
+  for (unsigned int i = 0; i < length; i++) {
+    if (scanner.update(stream[i]) != UBXScanner::Done)
+      continue;
+
+    const unsigned char *message = scanner.getMessage() + scanner.getPosition() - scanner.getMessageLength();
+    int id_shift = decodeShift(message, scanner.getMessageLength(), data_shift);
+    int id_struct = parser.decodeMessage(data_struct);
+    parser.decodeMessage(dispatcher);
+
+    // The previous decoder did not check the payload length and read past short messages
+    unsigned int payload_length = scanner.getMessageLength() - 8;
+    bool short_payload = (id_shift == UBXNavPOSLLH::ID && payload_length < sizeof(UBXNavPOSLLH)) ||
+                         (id_shift == UBXNavSTATUS::ID && payload_length < sizeof(UBXNavSTATUS));
+    if (!short_payload && (id_shift != id_struct || (id_shift != 0 && data_shift != data_struct)))
+      mismatches++;
+    messages++;
+    scanner.reset();
+  }
+  printf("Scanned messages: %ld, decoder mismatches: %ld\n", messages, mismatches);
+  printf("Dispatched NAV-PVT %ld, NAV-POSLLH %ld, NAV-VELNED %ld, NAV-STATUS %ld, TIM-TP %ld\n\n",
+         counts.pvt, counts.posllh, counts.velned, counts.status, counts.timtp);
+
+  // Run time, scanning included
+  long time_scan = 0, time_shift = 0, time_struct = 0, time_dispatch = 0;
+  volatile long sink = 0;
+
+  for (int pass = 0; pass < PASSES; pass++) {
+    long start = timeUs();
+    scanner.reset();
+    for (unsigned int i = 0; i < length; i++)
+      if (scanner.update(stream[i]) == UBXScanner::Done) {
+        sink += scanner.getMessageLength();
+        scanner.reset();
+      }
+    time_scan += timeUs() - start;
+
+    start = timeUs();
+    scanner.reset();
+    for (unsigned int i = 0; i < length; i++)
+      if (scanner.update(stream[i]) == UBXScanner::Done) {
+        sink += decodeShift(scanner.getMessage() + scanner.getPosition() - scanner.getMessageLength(),
+                            scanner.getMessageLength(), data_shift);
+        scanner.reset();
+      }
+    time_shift += timeUs() - start;
+
+    start = timeUs();
+    scanner.reset();
+    for (unsigned int i = 0; i < length; i++)
+      if (scanner.update(stream[i]) == UBXScanner::Done) {
+        sink += parser.decodeMessage(data_struct);
+        scanner.reset();
+      }
+    time_struct += timeUs() - start;
+
+    start = timeUs();
+    scanner.reset();
+    for (unsigned int i = 0; i < length; i++)
+      if (scanner.update(stream[i]) == UBXScanner::Done) {
+        sink += parser.decodeMessage(dispatcher);
+        scanner.reset();
+      }
+    time_dispatch += timeUs() - start;
+  }
+  sink += counts.checksum;
+
+  double mbytes = (double)length * PASSES / (1024 * 1024);
+  printf("Scan and decode throughput\n");
+  printf("  scan only:          %7.1f MB/s\n", mbytes / (time_scan / 1e6));
+  printf("  shift into vector:  %7.1f MB/s, %6.1f ns/message\n", mbytes / (time_shift / 1e6),
+         (time_shift - time_scan) * 1000.0 / (messages * PASSES));
+  printf("  struct into vector: %7.1f MB/s, %6.1f ns/message\n", mbytes / (time_struct / 1e6),
+         (time_struct - time_scan) * 1000.0 / (messages * PASSES));
+  printf("  dispatch table:     %7.1f MB/s, %6.1f ns/message\n", mbytes / (time_dispatch / 1e6),
+         (time_dispatch - time_scan) * 1000.0 / (messages * PASSES));
+
+  delete[] stream;
+  return mismatches != 0;
+}